@@ -4,6 +4,16 @@
 #define FLOW_PIN 12   
 #define MOTION_PIN 5   
 
+// 1 = 16-byte binary state on suction/<room>/state/bin, 0 = JSON on suction/<room>/state.
+// Binary needs a copy of webapp/include/state_codec.h next to this sketch.
+#ifndef PAYLOAD_BINARY
+#define PAYLOAD_BINARY 0
+#endif
+
+#if PAYLOAD_BINARY
+#include "state_codec.h"
+#endif
+
 const unsigned long MOTION_STABLE_MS = 5000;  // 5 seconds
 
 // ── Wi-Fi & MQTT Config ─────────────────────────────
@@ -16,9 +26,16 @@ const int   MQTT_PORT  = 1883;
 const char* ROOM_NAME  = "OR-DEV";             // <room> for topic suction/<room>/state
 const char* DEVICE_ID  = "esp32_dev1";
 
-const char* TOPIC_STATUS = "suction/dev1/status";
+// "suction/<room>/status"; must use ROOM_NAME so the server can match it
+char TOPIC_STATUS[96];
+
+// Re-announce "online" so a quiet sensor is not mistaken for a dead one
+const unsigned long HEARTBEAT_MS = 30000;
+unsigned long lastHeartbeatMs = 0;
 
 char TOPIC_STATE[96];
+char TOPIC_STATE_BIN[96];
+uint32_t stateSeq = 0;   // per-publish counter; the server orders and gap-checks on it
 
 WiFiClient wifiClient;
 PubSubClient mqtt(wifiClient);
@@ -63,6 +80,13 @@ bool connectMQTT() {
   if (ok) {
     Serial.println("MQTT connected.");
     mqtt.publish(TOPIC_STATUS, "{\"status\":\"online\"}", true);
+    // Clear the retained state left in the other format, or the server would
+    // replay two conflicting states for this room at startup.
+#if PAYLOAD_BINARY
+    mqtt.publish(TOPIC_STATE, "", true);
+#else
+    mqtt.publish(TOPIC_STATE_BIN, "", true);
+#endif
   } else {
     Serial.print("MQTT connect FAILED, state=");
     Serial.println(mqtt.state());
@@ -71,16 +95,30 @@ bool connectMQTT() {
 }
 
 void publishState(bool suction, bool motion) {
-  // topic:   suction/<room>/state
-  // payload: {"suction_on": true/false, "motion": true/false}
   const char* s_val = suction ? "true" : "false";
   const char* m_val = motion  ? "true" : "false";
 
-  char buf[96];
+#if PAYLOAD_BINARY
+  // topic:   suction/<room>/state/bin
+  // payload: state_codec.h layout (flags, seq, millis())
+  suction_state_t st;
+  st.flags = (suction ? SUCTION_STATE_FLAG_ON : 0) | (motion ? SUCTION_STATE_FLAG_MOTION : 0);
+  st.seq = stateSeq++;
+  st.device_ms = millis();
+  uint8_t buf[SUCTION_STATE_SIZE];
+  suction_state_encode(&st, buf);
+
+  bool ok = mqtt.publish(TOPIC_STATE_BIN, buf, sizeof(buf), true);
+#else
+  // topic:   suction/<room>/state
+  // payload: {"suction_on": true/false, "motion": true/false, "seq": n, "ts": millis()}
+  char buf[128];
   snprintf(buf, sizeof(buf),
-           "{\"suction_on\":%s,\"motion\":%s}", s_val, m_val);
+           "{\"suction_on\":%s,\"motion\":%s,\"seq\":%lu,\"ts\":%lu}",
+           s_val, m_val, (unsigned long)stateSeq++, (unsigned long)millis());
 
   bool ok = mqtt.publish(TOPIC_STATE, buf, true);
+#endif
   Serial.print("Publish state: suction_on=");
   Serial.print(s_val);
   Serial.print(", motion=");
@@ -99,6 +137,8 @@ void setup() {
 
   // Build the MQTT state topic once
   snprintf(TOPIC_STATE, sizeof(TOPIC_STATE), "suction/%s/state", ROOM_NAME);
+  snprintf(TOPIC_STATE_BIN, sizeof(TOPIC_STATE_BIN), "suction/%s/state/bin", ROOM_NAME);
+  snprintf(TOPIC_STATUS, sizeof(TOPIC_STATUS), "suction/%s/status", ROOM_NAME);
 
   delay(150);
   connectWiFi();
@@ -130,6 +170,11 @@ void loop() {
   }
   mqtt.loop();
 
+  if (mqtt.connected() && millis() - lastHeartbeatMs >= HEARTBEAT_MS) {
+    lastHeartbeatMs = millis();
+    mqtt.publish(TOPIC_STATUS, "{\"status\":\"online\"}", true);
+  }
+
   if (millis() - lastSampleMs >= 100) {
     lastSampleMs = millis();
     unsigned long now = millis();
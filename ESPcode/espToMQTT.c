@@ -18,8 +18,14 @@ const int   MQTT_PORT  = 1883;
 const char* ROOM_NAME  = "OR-DEV";             // <room> for topic suction/<room>/state
 const char* DEVICE_ID  = "esp32_dev1";
 
-// Optional device status topic (Last Will & Testament)
-const char* TOPIC_STATUS = "suction/dev1/status";
+// Device status topic "suction/<room>/status" (Last Will & Testament).
+// Must use ROOM_NAME: the server matches it to the room's state topic.
+char TOPIC_STATUS[96];
+
+// Re-announce "online" this often so the server can tell a quiet sensor
+// (suction unchanged for hours) from a dead one.
+const unsigned long HEARTBEAT_MS = 30000;
+unsigned long lastHeartbeatMs = 0;
 
 // Compose state topic: "suction/<room>/state"
 char TOPIC_STATE[96];
@@ -113,8 +119,9 @@ void setup() {
   pinMode(ECHO_PIN, INPUT);
   digitalWrite(TRIG_PIN, LOW);
 
-  // Build the state topic once
+  // Build the state and status topics once
   snprintf(TOPIC_STATE, sizeof(TOPIC_STATE), "suction/%s/state", ROOM_NAME);
+  snprintf(TOPIC_STATUS, sizeof(TOPIC_STATUS), "suction/%s/status", ROOM_NAME);
 
   delay(150);
   connectWiFi();
@@ -137,6 +144,12 @@ void loop() {
   }
   mqtt.loop();
 
+  // Heartbeat
+  if (mqtt.connected() && millis() - lastHeartbeatMs >= HEARTBEAT_MS) {
+    lastHeartbeatMs = millis();
+    mqtt.publish(TOPIC_STATUS, "{\"status\":\"online\"}", true /*retained*/);
+  }
+
   // Sample every ~100 ms (adjust as desired)
   if (millis() - lastSampleMs >= 100) {
     lastSampleMs = millis();
@@ -0,0 +1,103 @@
+// bench/batch_bench.cpp
+// Bulk suction updates: what POST /api/suction/batch does vs. what the same
+// updates cost through /api/rooms/<id>/suction/<s>, one call each.
+//   ./batch-bench [updates] [rooms]
+// Both run against a throwaway on-disk database and include the time until
+// everything is committed. HTTP is not included: the single-item route also
+// pays one round trip per update, the batch one per call.
+#include "repo.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const char* kDbPath = "batch_bench.db";
+
+    void remove_db() {
+        unlink(kDbPath);
+        unlink("batch_bench.db-wal");
+        unlink("batch_bench.db-shm");
+    }
+
+    std::vector<int> make_rooms(Repo& repo, int count) {
+        std::vector<int> ids;
+        ids.reserve(count);
+        for (int i = 0; i < count; ++i) ids.push_back(repo.ensure_room_id("K-" + std::to_string(i)));
+        return ids;
+    }
+
+    // Update i flips room i % rooms, so every update writes a log row.
+    bool state_of(int i, std::size_t rooms) { return (static_cast<std::size_t>(i) / rooms) % 2 == 0; }
+
+    void report(const char* name, int updates, int calls, Clock::duration elapsed) {
+        const double secs = std::chrono::duration<double>(elapsed).count();
+        std::printf("%-24s %8d updates  %7d calls  %9.1f ms  %10.0f updates/s\n",
+                    name, updates, calls, secs * 1e3, updates / secs);
+    }
+
+    // The final state every room must end up in.
+    bool check(Repo& repo, const std::vector<int>& ids, int updates) {
+        for (std::size_t r = 0; r < ids.size() && static_cast<int>(r) < updates; ++r) {
+            const int last = updates - 1 - static_cast<int>((updates - 1 - r) % ids.size());
+            if (repo.suction_state(ids[r]) != state_of(last, ids.size())) return false;
+        }
+        return true;
+    }
+
+    bool bench_single(int updates, int rooms) {
+        remove_db();
+        Repo repo(kDbPath);
+        const auto ids = make_rooms(repo, rooms);
+
+        const auto t0 = Clock::now();
+        for (int i = 0; i < updates; ++i) repo.update_suction(ids[i % ids.size()], state_of(i, ids.size()));
+        repo.flush();
+        report("single-item route", updates, updates, Clock::now() - t0);
+        return check(repo, ids, updates);
+    }
+
+    bool bench_batch(int updates, int rooms, int batch_size) {
+        remove_db();
+        Repo repo(kDbPath);
+        const auto ids = make_rooms(repo, rooms);
+
+        const std::int64_t ts = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        std::vector<SuctionUpdate> batch;
+        batch.reserve(static_cast<std::size_t>(batch_size));
+        int calls = 0;
+        bool all_applied = true;
+        const auto t0 = Clock::now();
+        for (int i = 0; i < updates;) {
+            batch.clear();
+            for (; i < updates && static_cast<int>(batch.size()) < batch_size; ++i) {
+                batch.push_back({ids[i % ids.size()], state_of(i, ids.size()), ts});
+            }
+            for (auto s : repo.update_suction_batch(batch)) all_applied = all_applied && s == SuctionUpdateStatus::Applied;
+            ++calls;
+        }
+        const auto elapsed = Clock::now() - t0;
+        const std::string name = "batch of " + std::to_string(batch_size);
+        report(name.c_str(), updates, calls, elapsed);
+        return all_applied && check(repo, ids, updates);
+    }
+}
+
+int main(int argc, char** argv) {
+    const int updates = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const int rooms   = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    bool ok = bench_single(updates, rooms);
+    for (int size : {10, 100, 1000, 10000}) ok = bench_batch(updates, rooms, size) && ok;
+    remove_db();
+    if (!ok) {
+        std::fprintf(stderr, "final room states differ from the updates sent\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,150 @@
+// bench/ingest_parse_bench.cpp
+// Per-message parse cost of MQTT state messages, old path vs. new.
+//   ./ingest-parse-bench [messages]
+// "legacy" is what on_message used to do: copy topic and payload into
+// std::string, substr the room, build an nlohmann DOM. "fast" is what it does
+// now: string_views over the buffers and parse_state_payload(), with the
+// nlohmann fallback for shapes it does not recognise. "binary" is the
+// fixed-layout payload from state_codec.h on ".../state/bin".
+#include "state_codec.h"
+#include "state_payload.hpp"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+
+namespace {
+    std::atomic<std::size_t> g_allocs{0};
+}
+
+// Count every heap allocation in the process.
+// (GCC flags the malloc/free pairing once these get inlined into std::allocator.)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(std::size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Message {
+        const char* topic;
+        const char* payload;
+        std::size_t len;
+    };
+
+    // What ends up in the ingest queue: a fixed buffer, like MqttIngestor::Update.
+    struct Parsed {
+        char room[62];
+        std::size_t room_len;
+        bool suction_on;
+    };
+
+    bool legacy(const Message& m, Parsed& out) {
+        try {
+            std::string topic(m.topic);
+            std::string payload(m.payload, m.len);
+            auto first = topic.find('/');
+            if (first == std::string::npos) return false;
+            auto second = topic.find('/', first + 1);
+            if (second == std::string::npos) return false;
+            std::string room = topic.substr(first + 1, second - (first + 1));
+            nlohmann::json j = nlohmann::json::parse(payload);
+            out.suction_on = j.value("suction_on", false);
+            out.room_len = std::min(room.size(), sizeof(out.room));
+            std::memcpy(out.room, room.data(), out.room_len);
+            return true;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    bool fast(const Message& m, Parsed& out) {
+        std::string_view payload(m.payload, m.len);
+        std::string_view room = room_from_topic(m.topic);
+        if (room.empty() || room.size() > sizeof(out.room)) return false;
+        out.room_len = room.size();
+        std::memcpy(out.room, room.data(), room.size());
+
+        StatePayload state;
+        if (parse_state_payload(payload, state)) {
+            out.suction_on = state.suction_on;
+            return true;
+        }
+        try {
+            nlohmann::json j = nlohmann::json::parse(payload.begin(), payload.end());
+            out.suction_on = j.value("suction_on", false);
+            return true;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    bool binary(const Message& m, Parsed& out) {
+        std::string_view room = room_from_topic(m.topic);
+        if (room.empty() || room.size() > sizeof(out.room)) return false;
+        out.room_len = room.size();
+        std::memcpy(out.room, room.data(), room.size());
+
+        suction_state_t state;
+        if (suction_state_decode(reinterpret_cast<const std::uint8_t*>(m.payload), m.len, &state) != SUCTION_STATE_OK) {
+            return false;
+        }
+        out.suction_on = (state.flags & SUCTION_STATE_FLAG_ON) != 0;
+        return true;
+    }
+
+    Message json_message(const char* topic, const char* payload) {
+        return {topic, payload, std::strlen(payload)};
+    }
+
+    template <class F>
+    void run(const char* name, const Message& m, int messages, F&& parse) {
+        Parsed out{};
+        int on = 0;
+        const std::size_t allocs0 = g_allocs.load();
+        const auto t0 = Clock::now();
+        for (int i = 0; i < messages; ++i) {
+            if (parse(m, out) && out.suction_on) ++on;
+        }
+        const double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+        const double allocs = static_cast<double>(g_allocs.load() - allocs0) / messages;
+        std::printf("%-28s %12.0f msg/s  %7.1f ns/msg  %5.2f allocs/msg\n",
+                    name, messages / secs, secs * 1e9 / messages, allocs);
+        if (on != messages) std::printf("  !! parsed suction_on=true %d/%d times\n", on, messages);
+    }
+}
+
+int main(int argc, char** argv) {
+    const int messages = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+    // What the ESP32 firmware publishes.
+    const Message firmware = json_message("suction/OR 12/state", R"({"suction_on":true,"motion":false})");
+    // An extra field the fast path does not know: exercises the fallback.
+    const Message other = json_message("suction/OR 12/state", R"({"suction_on":true,"motion":false,"rssi":-61})");
+    // The same state from firmware built with PAYLOAD_BINARY.
+    std::uint8_t bin[SUCTION_STATE_SIZE];
+    const suction_state_t state{SUCTION_STATE_FLAG_ON, 4242, 1700000000000ull};
+    suction_state_encode(&state, bin);
+    const Message compact{"suction/OR 12/state/bin", reinterpret_cast<const char*>(bin), sizeof(bin)};
+
+    run("legacy (firmware payload)", firmware, messages, legacy);
+    run("fast   (firmware payload)", firmware, messages, fast);
+    run("legacy (unknown shape)", other, messages, legacy);
+    run("fast   (unknown shape)", other, messages, fast);
+    run("binary (firmware payload)", compact, messages, binary);
+    std::printf("payload bytes: json %zu, binary %zu\n", firmware.len, compact.len);
+    return 0;
+}
@@ -0,0 +1,73 @@
+// bench/metrics_bench.cpp
+// Cost of recording into metrics() from the hot path, alone and with every
+// thread hammering the same metric.
+//   ./metrics-bench [threads] [iterations per thread]
+// "shared atomic" is the naive alternative: one fetch_add on one cache line
+// that every thread fights over.
+#include "metrics.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Wall time per operation with `threads` threads running `op` at once
+    // (so on N free cores, N uncontended threads would show 1/N of one).
+    template <class F>
+    double ns_per_op(int threads, int iterations, F&& op) {
+        std::atomic<int> ready{0};
+        std::atomic<bool> go{false};
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; ++t) {
+            pool.emplace_back([&] {
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                for (int i = 0; i < iterations; ++i) op(i);
+            });
+        }
+        while (ready.load() < threads) std::this_thread::yield();
+        const auto t0 = Clock::now();
+        go.store(true, std::memory_order_release);
+        for (auto& t : pool) t.join();
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        return ns / (static_cast<double>(threads) * iterations);
+    }
+
+    template <class F>
+    void row(const char* name, int threads, int iterations, F&& op) {
+        const double one = ns_per_op(1, iterations, op);
+        const double many = ns_per_op(threads, iterations, op);
+        std::printf("%-26s %8.1f ns/op  %8.1f ns/op\n", name, one, many);
+    }
+}
+
+int main(int argc, char** argv) {
+    const int threads    = argc > 1 ? std::atoi(argv[1]) : 8;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 5'000'000;
+
+    Counter& counter = metrics().counter("bench_ops_total", "Benchmark operations.");
+    Histogram& histogram = metrics().histogram("bench_op_seconds", "Benchmark latency.");
+    std::atomic<std::uint64_t> shared{0};
+    std::mutex mtx;
+
+    std::printf("%-26s %14s  %14s\n", "", "1 thread", (std::to_string(threads) + " threads").c_str());
+    row("shared atomic fetch_add", threads, iterations, [&](int) { shared.fetch_add(1, std::memory_order_relaxed); });
+    row("Counter::inc", threads, iterations, [&](int) { counter.inc(); });
+    row("Histogram::observe_ns", threads, iterations, [&](int i) { histogram.observe_ns(static_cast<std::uint64_t>(i) * 131); });
+    row("ScopedTimer", threads, iterations, [&](int) { const ScopedTimer t(histogram); });
+    // All threads share one mutex, so the second column includes real waiting.
+    row("timed_lock (one mutex)", threads, iterations / 10, [&](int) { auto lk = timed_lock(mtx, histogram); });
+
+    const auto totals = histogram.totals();
+    std::uint64_t n = 0;
+    for (auto b : totals.buckets) n += b;
+    std::printf("counter %llu, histogram %llu observations\n",
+                static_cast<unsigned long long>(counter.value()), static_cast<unsigned long long>(n));
+    return 0;
+}
@@ -0,0 +1,129 @@
+// bench/render_bench.cpp
+// GET / page rendering, old path vs. new, over synthetic rooms.
+//   ./render-bench [rooms] [iterations]
+// "legacy" is what render_dashboard() used to do: stream the inline CSS, the
+// page shell, every card and the inline JS through std::ostringstream. "template"
+// is the precompiled shell with only the cards (and the timestamp) filled in;
+// CSS and JS are now separate cached assets, so they are not in the page.
+// The card markup must come out byte-for-byte the same.
+#include "util.hpp"
+#include "views.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // The cards part of the old renderer, verbatim; CSS and JS were
+    // constant strings of the same sizes as today's assets.
+    std::string legacy_render(const std::vector<OperatingRoom>& rooms, const std::string& css, const std::string& js) {
+        std::ostringstream cards;
+        for (const auto& room : rooms) {
+            const bool suctionon = room.suction_on;
+            const bool ok = (suctionon && room.procedure != "Idle / Unscheduled") ||  (!suctionon && room.procedure == "Idle / Unscheduled");
+            cards << "<article class='room-card " << (ok ? "room-card--ok" : "room-card--warn")
+                  << (room.stale ? " room-card--stale" : "")
+                  << "' data-room-id='" << room.id << "'>";
+            cards << "<div class='card-header'>";
+            cards << "<h3>" << room.room_number << "</h3>";
+            if (!ok) { cards << "<div class='status-icon' aria-hidden='true'>⚠️</div>"; }
+            cards << "</div>";
+            cards << "<p class='meta'>" << room.procedure << "</p>";
+            cards << "<p class='time'>" << room.schedule << "</p>";
+            cards << "<div class='status'>";
+            cards << "<span class='icon'>" << (suctionon ? "🟢" : "🔴") << "</span>";
+            cards << "Suction: " << (suctionon ? "ON" : "OFF");
+            cards << "</div>";
+            cards << "<p class='liveness'" << (room.stale ? "" : " hidden") << ">📡 Sensor offline – last known state</p>";
+            cards << "</article>";
+        }
+
+        std::ostringstream page;
+        page << "<!DOCTYPE html><html lang='en'><head><meta charset='utf-8'/>"
+             << "<meta name='viewport' content='width=device-width,initial-scale=1'/>"
+             << "<title>SuctionSense Dashboard</title>"
+             << "<link rel='preconnect' href='https://fonts.googleapis.com'>"
+             << "<link rel='preconnect' href='https://fonts.gstatic.com' crossorigin>"
+             << "<link href='https://fonts.googleapis.com/css2?family=Inter:wght@400;500;600;700;800&display=swap' rel='stylesheet'>"
+             << "<style>" << css << "</style></head><body><main>";
+        page << "<header><div class='logo'><div class='logo-symbol'>S</div>"
+             << "<span class='logo-text'>SuctionSense</span></div>"
+             << "<h1>Operating Room Suction Status</h1>"
+             << "<p class='subtitle'>Real-time monitoring dashboard</p></header>";
+        page << "<section class='cards'>" << cards.str() << "</section>";
+        page << "<footer><p>Last updated: <span id='last-updated'>" << format_timestamp() << "</span></p></footer>";
+        page << "</main>";
+        page << "<script>" << js << "</script>";
+        page << "</body></html>";
+        return page.str();
+    }
+
+    std::string cards_of(const std::string& page) {
+        const std::string open = "<section class='cards'>";
+        const auto from = page.find(open) + open.size();
+        return page.substr(from, page.find("</section>", from) - from);
+    }
+
+    template <class F>
+    double us_per_page(int iterations, std::size_t& bytes, F&& render) {
+        bytes = 0;
+        const auto t0 = Clock::now();
+        for (int i = 0; i < iterations; ++i) bytes += render().size();
+        const double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+        bytes /= static_cast<std::size_t>(iterations);
+        return us / iterations;
+    }
+}
+
+int main(int argc, char** argv) {
+    const int room_count = argc > 1 ? std::atoi(argv[1]) : 5000;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    std::vector<OperatingRoom> rooms;
+    rooms.reserve(static_cast<std::size_t>(room_count));
+    for (int i = 0; i < room_count; ++i) {
+        OperatingRoom r;
+        r.id = i + 1;
+        r.room_number = "OR-" + std::to_string(i + 1);
+        r.procedure = i % 3 ? "Laparoscopic cholecystectomy" : "Idle / Unscheduled";
+        r.schedule = i % 3 ? "08:00 - 10:30" : "No upcoming events";
+        r.suction_on = i % 2 == 0;
+        r.stale = i % 17 == 0;
+        rooms.push_back(std::move(r));
+    }
+
+    // The asset paths come from the template, so look them up through it.
+    const std::string sample = render_dashboard({});
+    auto asset_in = [&](const char* attr) {
+        const auto at = sample.find(attr) + std::string(attr).size();
+        return find_asset(sample.substr(at, sample.find('\'', at) - at));
+    };
+    const StaticAsset* css = asset_in("href='");
+    const StaticAsset* js = asset_in("src='");
+    if (!css || !js) {
+        std::fprintf(stderr, "page does not link its assets\n");
+        return 1;
+    }
+
+    if (cards_of(legacy_render(rooms, css->body, js->body)) != cards_of(render_dashboard(rooms))) {
+        std::fprintf(stderr, "card markup differs from the legacy renderer\n");
+        return 1;
+    }
+
+    std::size_t legacy_bytes = 0, template_bytes = 0;
+    const double legacy_us = us_per_page(iterations, legacy_bytes, [&] { return legacy_render(rooms, css->body, js->body); });
+    const double template_us = us_per_page(iterations, template_bytes, [&] { return render_dashboard(rooms); });
+
+    std::printf("%d rooms, %d iterations\n", room_count, iterations);
+    std::printf("legacy    %9.1f us/page  %8zu bytes\n", legacy_us, legacy_bytes);
+    std::printf("template  %9.1f us/page  %8zu bytes  (%.1fx)\n", template_us, template_bytes, legacy_us / template_us);
+    for (const StaticAsset* a : {css, js}) {
+        std::printf("%-40s %6zu bytes, gzip %6zu, br %6zu\n",
+                    a->path.c_str(), a->body.size(), a->gzip.size(), a->brotli.size());
+    }
+    return 0;
+}
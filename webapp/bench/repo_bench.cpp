@@ -0,0 +1,187 @@
+// bench/repo_bench.cpp
+// Micro-benchmarks for Repo against a throwaway on-disk database.
+//   ./repo-bench [iterations]
+#include "repo.hpp"
+#include "models.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const char* kDbPath = "repo_bench.db";
+
+    void remove_db() {
+        unlink(kDbPath);
+        unlink("repo_bench.db-wal");
+        unlink("repo_bench.db-shm");
+    }
+
+    // Creates `count` rooms named "B-<n>" and returns their ids.
+    std::vector<int> make_rooms(Repo& repo, int count) {
+        std::vector<int> ids;
+        ids.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            ids.push_back(repo.ensure_room_id("B-" + std::to_string(i)));
+        }
+        return ids;
+    }
+
+    void report(const char* name, int ops, Clock::duration elapsed) {
+        const double secs = std::chrono::duration<double>(elapsed).count();
+        std::printf("%-28s %8d ops  %9.1f ms  %10.0f ops/s  %7.2f us/op\n",
+                    name, ops, secs * 1e3, ops / secs, secs * 1e6 / ops);
+    }
+
+    // Every call flips the room's state: SELECT + log INSERT + state UPSERT.
+    // Timings include the final flush(), i.e. until everything is committed.
+    void bench_update_suction_toggle(int iterations) {
+        remove_db();
+        Repo repo(kDbPath);
+        auto ids = make_rooms(repo, 64);
+
+        const auto t0 = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            repo.update_suction(ids[i % ids.size()], (i / ids.size()) % 2 == 0);
+        }
+        repo.flush();
+        report("update_suction (toggle)", iterations, Clock::now() - t0);
+    }
+
+    // Same state every time: SELECT + state UPSERT, no log row.
+    void bench_update_suction_steady(int iterations) {
+        remove_db();
+        Repo repo(kDbPath);
+        auto ids = make_rooms(repo, 64);
+
+        const auto t0 = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            repo.update_suction(ids[i % ids.size()], true);
+        }
+        repo.flush();
+        report("update_suction (steady)", iterations, Clock::now() - t0);
+    }
+
+    // The MQTT ingest path: resolve an already-known room_number to its id.
+    void bench_ensure_room_id(int iterations) {
+        remove_db();
+        Repo repo(kDbPath);
+        make_rooms(repo, 64);
+        std::vector<std::string> names;
+        for (int i = 0; i < 64; ++i) names.push_back("B-" + std::to_string(i));
+
+        long sum = 0;
+        const auto t0 = Clock::now();
+        for (int i = 0; i < iterations; ++i) sum += repo.ensure_room_id(names[i % names.size()]);
+        report("ensure_room_id (known)", iterations, Clock::now() - t0);
+        if (sum == 0) std::printf("  !! no ids resolved\n");
+    }
+
+    // N rooms with one schedule window each; a quarter have suction on and the
+    // rest are explicitly off. Measures a cold open (schema + full room load)
+    // and a warm load_rooms().
+    void bench_load_rooms(int rooms) {
+        remove_db();
+        {
+            Repo repo(kDbPath);
+            for (int i = 0; i < rooms; ++i) {
+                OperatingRoom r{0, "L-" + std::to_string(i), "Procedure", "08:00 - 17:00", false};
+                repo.insert_room(r);
+            }
+            for (const auto& r : repo.load_rooms()) repo.update_suction(r.id, r.id % 4 == 0);
+        }
+
+        const int opens = rooms >= 5000 ? 5 : 20;
+        auto t0 = Clock::now();
+        for (int i = 0; i < opens; ++i) {
+            Repo repo(kDbPath);
+        }
+        const auto open_elapsed = Clock::now() - t0;
+
+        Repo repo(kDbPath);
+        const int loads = 200;
+        std::size_t seen = 0;
+        t0 = Clock::now();
+        for (int i = 0; i < loads; ++i) seen += repo.load_rooms().size();
+        const auto load_elapsed = Clock::now() - t0;
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "open+load (%d rooms)", rooms);
+        report(name, opens, open_elapsed);
+        std::snprintf(name, sizeof(name), "load_rooms (%d rooms)", rooms);
+        report(name, loads, load_elapsed);
+        if (seen != static_cast<std::size_t>(rooms) * loads) std::printf("  !! saw %zu rooms\n", seen);
+    }
+
+    double percentile(std::vector<double>& v, double p) {
+        if (v.empty()) return 0;
+        const auto k = static_cast<std::size_t>(p * (v.size() - 1));
+        std::nth_element(v.begin(), v.begin() + k, v.end());
+        return v[k];
+    }
+
+    // `readers` threads call load_rooms() flat out for two seconds while one
+    // writer calls update_suction() at `writes_per_sec`.
+    void bench_contention(int readers, int writes_per_sec) {
+        remove_db();
+        Repo repo(kDbPath);
+        auto ids = make_rooms(repo, 500);
+
+        std::atomic<bool> done{false};
+        std::vector<std::vector<double>> samples(readers);
+        std::vector<std::thread> threads;
+        for (int r = 0; r < readers; ++r) {
+            threads.emplace_back([&, r] {
+                auto& out = samples[r];
+                while (!done.load(std::memory_order_relaxed)) {
+                    const auto t0 = Clock::now();
+                    auto rooms = repo.load_rooms();
+                    out.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+                }
+            });
+        }
+
+        const auto period = std::chrono::nanoseconds(1'000'000'000LL / writes_per_sec);
+        const auto start = Clock::now();
+        auto next = start;
+        int writes = 0;
+        while (Clock::now() - start < std::chrono::seconds(2)) {
+            repo.update_suction(ids[writes % ids.size()], writes % 2 == 0);
+            ++writes;
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+        done = true;
+        for (auto& t : threads) t.join();
+        repo.flush();
+
+        std::vector<double> all;
+        for (auto& v : samples) all.insert(all.end(), v.begin(), v.end());
+        const double secs = std::chrono::duration<double>(Clock::now() - start).count();
+        const double p50 = percentile(all, 0.50);
+        const double p99 = percentile(all, 0.99);
+        const double max = all.empty() ? 0 : *std::max_element(all.begin(), all.end());
+        std::printf("contention %2d readers, %5d writes/s: %9.0f loads/s  p50 %7.1f us  p99 %7.1f us  max %8.1f us\n",
+                    readers, writes_per_sec, all.size() / secs, p50, p99, max);
+    }
+}
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 20000;
+
+    bench_update_suction_toggle(iterations);
+    bench_update_suction_steady(iterations);
+    bench_ensure_room_id(iterations);
+    for (int rooms : {10, 500, 5000}) bench_load_rooms(rooms);
+    for (int readers : {1, 4, 16}) bench_contention(readers, 2000);
+
+    remove_db();
+    return 0;
+}
@@ -0,0 +1,103 @@
+// bench/rooms_cache_bench.cpp
+// /api/rooms body production with and without RoomsResponseCache, from
+// several threads at once (standing in for Crow's request threads).
+//   ./rooms-cache-bench [rooms] [threads] [seconds per case]
+// "uncached" is what the handler used to do per request: load_rooms(),
+// build the wvalue tree, dump(). The cached cases take the shared body
+// (copying it, as Crow's response does). HTTP itself is not included.
+#include "repo.hpp"
+#include "room_json.hpp"
+#include "rooms_cache.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const char* kDbPath = "rooms_cache_bench.db";
+
+    void remove_db() {
+        unlink(kDbPath);
+        unlink("rooms_cache_bench.db-wal");
+        unlink("rooms_cache_bench.db-shm");
+    }
+
+    // Runs `request` on `threads` threads for `seconds`, while an optional
+    // writer flips a room every `write_every` (zero = no writes).
+    template <class F>
+    void run(const char* name, Repo& repo, const std::vector<int>& ids, int threads, double seconds,
+             std::chrono::milliseconds write_every, F&& request) {
+        std::atomic<bool> go{true};
+        std::atomic<std::uint64_t> requests{0};
+        std::atomic<std::uint64_t> bytes{0};
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; ++t) {
+            pool.emplace_back([&] {
+                std::uint64_t n = 0, b = 0;
+                while (go.load(std::memory_order_relaxed)) {
+                    b += request().size();
+                    ++n;
+                }
+                requests += n;
+                bytes += b;
+            });
+        }
+        std::uint64_t writes = 0;
+        const auto end = Clock::now() + std::chrono::duration<double>(seconds);
+        while (Clock::now() < end) {
+            if (write_every.count() > 0) {
+                const int id = ids[writes++ % ids.size()];
+                repo.update_suction(id, !repo.suction_state(id).value_or(false));
+                std::this_thread::sleep_for(write_every);
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        go = false;
+        for (auto& t : pool) t.join();
+        const double n = static_cast<double>(requests.load());
+        std::printf("%-34s %12.0f req/s  %8.0f bytes/resp  %6llu writes\n",
+                    name, n / seconds, n > 0 ? static_cast<double>(bytes.load()) / n : 0.0,
+                    static_cast<unsigned long long>(writes));
+    }
+}
+
+int main(int argc, char** argv) {
+    const int room_count = argc > 1 ? std::atoi(argv[1]) : 1000;
+    const int threads    = argc > 2 ? std::atoi(argv[2]) : 8;
+    const double seconds = argc > 3 ? std::atof(argv[3]) : 2.0;
+
+    remove_db();
+    {
+        Repo repo(kDbPath);
+        std::vector<int> ids;
+        for (int i = 0; i < room_count; ++i) ids.push_back(repo.ensure_room_id("C-" + std::to_string(i)));
+        RoomsResponseCache cache(repo);
+
+        auto uncached = [&] { return rooms_to_json(repo.load_rooms()).dump(); };
+        auto cached = [&](Encoding want) {
+            return [&, want] {
+                Encoding e = want;
+                return std::string(cache.get()->encoded(e));
+            };
+        };
+
+        std::printf("%d rooms, %d threads\n", room_count, threads);
+        const std::chrono::milliseconds none{0}, writes{100};
+        run("uncached", repo, ids, threads, seconds, none, uncached);
+        run("cached identity", repo, ids, threads, seconds, none, cached(Encoding::Identity));
+        run("cached gzip", repo, ids, threads, seconds, none, cached(Encoding::Gzip));
+        run("cached br", repo, ids, threads, seconds, none, cached(Encoding::Brotli));
+        run("uncached, 10 writes/s", repo, ids, threads, seconds, writes, uncached);
+        run("cached gzip, 10 writes/s", repo, ids, threads, seconds, writes, cached(Encoding::Gzip));
+        repo.flush();
+    }
+    remove_db();
+    return 0;
+}
@@ -0,0 +1,140 @@
+// bench/stream_bench.cpp
+// RoomBroadcaster fan-out: N in-process subscribers (standing in for
+// /api/rooms/stream connections) against a throwaway on-disk database.
+//   ./stream-bench [subscribers] [rooms] [bursts]
+// Each burst flips a handful of rooms and times how long until the last
+// subscriber has the delta. At the end every subscriber replays what it was
+// sent and must arrive at exactly the Repo's state.
+#include "repo.hpp"
+#include "room_broadcaster.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const char* kDbPath = "stream_bench.db";
+
+    void remove_db() {
+        unlink(kDbPath);
+        unlink("stream_bench.db-wal");
+        unlink("stream_bench.db-shm");
+    }
+
+    // What a browser tab would hold: every message it was sent, in order.
+    struct Subscriber {
+        std::mutex mtx;
+        std::vector<std::string> inbox;
+        std::atomic<std::size_t> received{0};
+        std::atomic<std::int64_t> last_ns{0};
+    };
+
+    std::int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    double percentile(std::vector<double> v, double p) {
+        if (v.empty()) return 0.0;
+        std::sort(v.begin(), v.end());
+        return v[std::min(v.size() - 1, static_cast<std::size_t>(p * static_cast<double>(v.size() - 1) + 0.5))];
+    }
+}
+
+int main(int argc, char** argv) {
+    const int subscribers = argc > 1 ? std::atoi(argv[1]) : 1000;
+    const int room_count  = argc > 2 ? std::atoi(argv[2]) : 200;
+    const int bursts      = argc > 3 ? std::atoi(argv[3]) : 200;
+    const int per_burst   = 5;
+
+    remove_db();
+    {
+        Repo repo(kDbPath);
+        std::vector<int> ids;
+        for (int i = 0; i < room_count; ++i) ids.push_back(repo.ensure_room_id("S-" + std::to_string(i)));
+
+        RoomBroadcaster broadcaster(repo);
+        broadcaster.start();
+
+        std::vector<std::unique_ptr<Subscriber>> subs;
+        subs.reserve(static_cast<std::size_t>(subscribers));
+        const auto t_sub = Clock::now();
+        for (int i = 0; i < subscribers; ++i) {
+            auto s = std::make_unique<Subscriber>();
+            Subscriber* sp = s.get();
+            broadcaster.subscribe(sp, [sp](const std::string& msg) {
+                {
+                    std::lock_guard<std::mutex> lk(sp->mtx);
+                    sp->inbox.push_back(msg);
+                }
+                sp->last_ns.store(now_ns(), std::memory_order_relaxed);
+                sp->received.fetch_add(1, std::memory_order_release);
+            });
+            subs.push_back(std::move(s));
+        }
+        const double sub_ms = std::chrono::duration<double, std::milli>(Clock::now() - t_sub).count();
+        std::printf("%d subscribers connected in %.1f ms (%zu subscribed)\n",
+                    subscribers, sub_ms, broadcaster.subscribers());
+
+        // Bursts: flip `per_burst` rooms, wait for every subscriber to get a
+        // message, and time first write -> last subscriber's delivery.
+        std::vector<double> fanout_ms;
+        std::size_t rr = 0;
+        for (int b = 0; b < bursts; ++b) {
+            std::vector<std::size_t> before;
+            before.reserve(subs.size());
+            for (auto& s : subs) before.push_back(s->received.load(std::memory_order_acquire));
+
+            const std::int64_t t0 = now_ns();
+            for (int k = 0; k < per_burst; ++k) {
+                const int id = ids[rr++ % ids.size()];
+                repo.update_suction(id, !repo.suction_state(id).value_or(false));
+            }
+            for (std::size_t i = 0; i < subs.size(); ++i) {
+                while (subs[i]->received.load(std::memory_order_acquire) == before[i]) std::this_thread::yield();
+            }
+            std::int64_t last = 0;
+            for (auto& s : subs) last = std::max(last, s->last_ns.load(std::memory_order_relaxed));
+            fanout_ms.push_back(static_cast<double>(last - t0) / 1e6);
+        }
+        // Let any trailing delta (changes merged after a send began) arrive.
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        broadcaster.stop();
+
+        const std::uint64_t sent = broadcaster.messages_sent();
+        std::printf("%d bursts x %d updates: %llu messages delivered (%.2f per subscriber per burst)\n",
+                    bursts, per_burst, static_cast<unsigned long long>(sent),
+                    static_cast<double>(sent - static_cast<std::uint64_t>(subscribers)) / subscribers / bursts);
+        std::printf("write -> last subscriber: p50 %.3f ms  p99 %.3f ms  max %.3f ms\n",
+                    percentile(fanout_ms, 0.50), percentile(fanout_ms, 0.99),
+                    *std::max_element(fanout_ms.begin(), fanout_ms.end()));
+
+        // Replay every inbox and compare with the Repo.
+        std::unordered_map<int, bool> truth;
+        for (const auto& r : repo.load_rooms()) truth[r.id] = r.suction_on;
+        int wrong = 0;
+        for (auto& s : subs) {
+            std::unordered_map<int, bool> view;
+            for (const auto& msg : s->inbox) {
+                const auto j = nlohmann::json::parse(msg);
+                if (j.value("type", "") == "rooms") view.clear();
+                for (const auto& room : j["rooms"]) view[room["id"].get<int>()] = room["suctionOn"].get<bool>();
+            }
+            if (view != truth) ++wrong;
+        }
+        std::printf("subscribers whose final view differs from the Repo: %d of %d\n", wrong, subscribers);
+        if (wrong) return 1;
+    }
+    remove_db();
+    return 0;
+}
@@ -0,0 +1,320 @@
+// bench/suction_loadgen.cpp
+// End-to-end load test against a running room-suction-status and a local
+// mosquitto broker: publishes suction states for synthetic rooms at a fixed
+// rate and polls /api/rooms to see when each one becomes visible.
+//   ./suction-loadgen [--rooms N] [--rate msgs/s] [--seconds S]
+//                     [--mqtt-port P] [--http-port P] [--poll-ms MS] [--binary]
+//
+// Rooms are named "LG-<n>"; the server creates them on first message. Each
+// publish flips the room's state, and a room is not published again until
+// the flip has shown up (or timed out), so every message is a real change
+// and its latency is unambiguous. Latency includes up to one poll interval.
+#include "state_codec.h"
+#include <mosquitto.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        int  rooms     = 100;
+        int  rate      = 1000; // publishes per second, across all rooms
+        int  seconds   = 10;
+        int  mqtt_port = 1883;
+        int  http_port = 18080;
+        int  poll_ms   = 10;
+        int  timeout_ms = 5000; // give up on a flip that never shows
+        bool binary    = false;
+    };
+
+    // Shared between the publisher (main thread) and the poller.
+    struct Room {
+        std::string           name;
+        std::string           topic;
+        std::atomic<bool>     expected{false};
+        std::atomic<std::int64_t> sent_ns{0}; // publish time of the flip in flight, 0 = none
+        std::uint32_t         seq = 0;
+    };
+
+    std::int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    bool parse_args(int argc, char** argv, Options& o) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view a = argv[i];
+            if (a == "--binary") { o.binary = true; continue; }
+            if (i + 1 >= argc) return false;
+            const int v = std::atoi(argv[++i]);
+            if (a == "--rooms")          o.rooms = v;
+            else if (a == "--rate")      o.rate = v;
+            else if (a == "--seconds")   o.seconds = v;
+            else if (a == "--mqtt-port") o.mqtt_port = v;
+            else if (a == "--http-port") o.http_port = v;
+            else if (a == "--poll-ms")   o.poll_ms = v;
+            else return false;
+        }
+        return o.rooms > 0 && o.rate > 0 && o.seconds > 0 && o.poll_ms > 0;
+    }
+
+    // One-shot HTTP/1.1 GET against 127.0.0.1; returns the body of a 200.
+    bool http_get(int port, const char* path, std::string& body) {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<std::uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            return false;
+        }
+        const std::string req = std::string("GET ") + path +
+                                " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+        if (send(fd, req.data(), req.size(), 0) != static_cast<ssize_t>(req.size())) {
+            close(fd);
+            return false;
+        }
+        std::string resp;
+        char buf[16384];
+        for (ssize_t n; (n = recv(fd, buf, sizeof(buf), 0)) > 0;) resp.append(buf, static_cast<std::size_t>(n));
+        close(fd);
+
+        const auto head_end = resp.find("\r\n\r\n");
+        if (head_end == std::string::npos || resp.compare(0, 7, "HTTP/1.") != 0 || resp.compare(8, 5, " 200 ") != 0) {
+            return false;
+        }
+        body = resp.substr(head_end + 4);
+        return true;
+    }
+
+    // Server-side ingest counters, to show what the broker actually delivered.
+    nlohmann::json ingest_stats(int port) {
+        std::string body;
+        if (!http_get(port, "/api/ingest/stats", body)) return {};
+        return nlohmann::json::parse(body, nullptr, false);
+    }
+
+    // Like the firmware, with ts as Unix ms so the server can time the device stage.
+    void publish(struct mosquitto* mosq, Room& room, bool on, bool binary) {
+        const auto ts = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        const std::uint32_t seq = room.seq++;
+        if (binary) {
+            suction_state_t st{static_cast<std::uint8_t>(on ? SUCTION_STATE_FLAG_ON : 0), seq, ts};
+            std::uint8_t buf[SUCTION_STATE_SIZE];
+            suction_state_encode(&st, buf);
+            mosquitto_publish(mosq, nullptr, room.topic.c_str(), sizeof(buf), buf, 1, false);
+        } else {
+            char payload[128];
+            const int n = std::snprintf(payload, sizeof(payload),
+                                        R"({"suction_on":%s,"motion":true,"seq":%u,"ts":%llu})",
+                                        on ? "true" : "false", seq, static_cast<unsigned long long>(ts));
+            mosquitto_publish(mosq, nullptr, room.topic.c_str(), n, payload, 1, false);
+        }
+    }
+
+    // Results gathered by the poller thread.
+    struct Observed {
+        std::vector<double> latencies_ms;
+        std::uint64_t timeouts = 0;
+        std::uint64_t polls = 0;
+        std::uint64_t poll_failures = 0;
+    };
+
+    // Polls /api/rooms until `running` clears, marking each in-flight flip
+    // visible once the room shows the expected state. Flips stuck longer than
+    // the timeout are counted lost, which frees the room for another publish.
+    void poll_loop(const Options& opt, std::vector<std::unique_ptr<Room>>& rooms,
+                   const std::unordered_map<std::string, Room*>& by_name,
+                   const std::atomic<bool>& running, Observed& out) {
+        std::string body;
+        while (running.load()) {
+            const auto next = Clock::now() + std::chrono::milliseconds(opt.poll_ms);
+            if (http_get(opt.http_port, "/api/rooms", body)) {
+                ++out.polls;
+                const std::int64_t seen = now_ns();
+                const auto j = nlohmann::json::parse(body, nullptr, false);
+                if (j.is_object() && j.contains("rooms")) {
+                    for (const auto& item : j["rooms"]) {
+                        auto it = by_name.find(item.value("roomNumber", ""));
+                        if (it == by_name.end()) continue;
+                        Room& r = *it->second;
+                        const std::int64_t sent = r.sent_ns.load(std::memory_order_acquire);
+                        if (sent == 0) continue;
+                        if (item.value("suctionOn", false) == r.expected.load(std::memory_order_relaxed)) {
+                            out.latencies_ms.push_back(static_cast<double>(seen - sent) / 1e6);
+                            r.sent_ns.store(0, std::memory_order_release);
+                        }
+                    }
+                }
+            } else {
+                ++out.poll_failures;
+            }
+            const std::int64_t cutoff = now_ns() - static_cast<std::int64_t>(opt.timeout_ms) * 1000000;
+            for (auto& r : rooms) {
+                const std::int64_t sent = r->sent_ns.load(std::memory_order_acquire);
+                if (sent != 0 && sent < cutoff) {
+                    ++out.timeouts;
+                    r->sent_ns.store(0, std::memory_order_release);
+                }
+            }
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    // Sends one flip for the room; the caller has checked nothing is in flight.
+    void flip(struct mosquitto* mosq, Room& r, bool on, bool binary) {
+        r.expected.store(on, std::memory_order_relaxed);
+        r.sent_ns.store(now_ns(), std::memory_order_release);
+        publish(mosq, r, on, binary);
+    }
+
+    std::uint64_t counter(const nlohmann::json& stats, const char* key) {
+        return stats.is_object() ? stats.value(key, std::uint64_t{0}) : 0;
+    }
+
+    double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0.0;
+        const std::size_t i = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(i, sorted.size() - 1)];
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: %s [--rooms N] [--rate msgs/s] [--seconds S] [--mqtt-port P] "
+                             "[--http-port P] [--poll-ms MS] [--binary]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<std::unique_ptr<Room>> rooms;
+    std::unordered_map<std::string, Room*> by_name;
+    for (int i = 0; i < opt.rooms; ++i) {
+        auto r = std::make_unique<Room>();
+        char name[32];
+        std::snprintf(name, sizeof(name), "LG-%04d", i);
+        r->name = name;
+        r->topic = "suction/" + r->name + (opt.binary ? "/state/bin" : "/state");
+        by_name.emplace(r->name, r.get());
+        rooms.push_back(std::move(r));
+    }
+
+    mosquitto_lib_init();
+    struct mosquitto* mosq = mosquitto_new("suction-loadgen", true, nullptr);
+    if (!mosq || mosquitto_connect(mosq, "127.0.0.1", opt.mqtt_port, 30) != MOSQ_ERR_SUCCESS ||
+        mosquitto_loop_start(mosq) != MOSQ_ERR_SUCCESS) {
+        std::fprintf(stderr, "cannot connect to mosquitto on 127.0.0.1:%d\n", opt.mqtt_port);
+        return 1;
+    }
+
+    // Warm-up: create every room and settle it at "off", so the first
+    // measured flip cannot be satisfied by state left over from an earlier run.
+    std::printf("warming up %d rooms...\n", opt.rooms);
+    {
+        std::atomic<bool> running{true};
+        Observed warm;
+        std::thread poller(poll_loop, std::cref(opt), std::ref(rooms), std::cref(by_name),
+                           std::cref(running), std::ref(warm));
+        for (auto& r : rooms) flip(mosq, *r, false, opt.binary);
+        const auto deadline = Clock::now() + std::chrono::milliseconds(opt.timeout_ms);
+        while (Clock::now() < deadline &&
+               std::any_of(rooms.begin(), rooms.end(), [](const auto& r) { return r->sent_ns.load() != 0; })) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(opt.poll_ms));
+        }
+        running.store(false);
+        poller.join();
+        if (warm.polls == 0) {
+            std::fprintf(stderr, "no successful GET /api/rooms on 127.0.0.1:%d\n", opt.http_port);
+            return 1;
+        }
+        if (warm.latencies_ms.size() < rooms.size()) {
+            std::fprintf(stderr, "warning: only %zu/%d rooms visible after warm-up\n",
+                         warm.latencies_ms.size(), opt.rooms);
+        }
+        for (auto& r : rooms) r->sent_ns.store(0);
+    }
+
+    // Measured run: publish slots at a fixed rate, round-robin over rooms;
+    // a slot whose room still has a flip in flight is skipped.
+    const nlohmann::json before = ingest_stats(opt.http_port);
+    std::atomic<bool> running{true};
+    Observed obs;
+    std::thread poller(poll_loop, std::cref(opt), std::ref(rooms), std::cref(by_name),
+                       std::cref(running), std::ref(obs));
+
+    std::uint64_t published = 0, skipped = 0;
+    const auto period = std::chrono::nanoseconds(1000000000LL / opt.rate);
+    const auto start = Clock::now();
+    const auto end = start + std::chrono::seconds(opt.seconds);
+    auto slot = start;
+    std::size_t next_room = 0;
+    while (slot < end) {
+        std::this_thread::sleep_until(slot);
+        Room& r = *rooms[next_room];
+        next_room = (next_room + 1) % rooms.size();
+        if (r.sent_ns.load(std::memory_order_acquire) != 0) {
+            ++skipped;
+        } else {
+            flip(mosq, r, !r.expected.load(std::memory_order_relaxed), opt.binary);
+            ++published;
+        }
+        slot += period;
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Let the last flips land, then stop.
+    const auto drain = Clock::now() + std::chrono::milliseconds(opt.timeout_ms);
+    while (Clock::now() < drain &&
+           std::any_of(rooms.begin(), rooms.end(), [](const auto& r) { return r->sent_ns.load() != 0; })) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(opt.poll_ms));
+    }
+    running.store(false);
+    poller.join();
+    const nlohmann::json after = ingest_stats(opt.http_port);
+
+    mosquitto_loop_stop(mosq, true);
+    mosquitto_disconnect(mosq);
+    mosquitto_destroy(mosq);
+    mosquitto_lib_cleanup();
+
+    std::sort(obs.latencies_ms.begin(), obs.latencies_ms.end());
+    std::printf("rooms %d  offered %d msg/s  %s payload  poll %d ms  %.1f s\n",
+                opt.rooms, opt.rate, opt.binary ? "binary" : "json", opt.poll_ms, elapsed);
+    std::printf("published %llu (%.0f msg/s)  skipped in flight %llu  visible %zu (%.0f msg/s)  timed out %llu\n",
+                static_cast<unsigned long long>(published), published / elapsed,
+                static_cast<unsigned long long>(skipped),
+                obs.latencies_ms.size(), obs.latencies_ms.size() / elapsed,
+                static_cast<unsigned long long>(obs.timeouts));
+    std::printf("publish->visible latency ms: p50 %.2f  p99 %.2f  max %.2f\n",
+                percentile(obs.latencies_ms, 0.50), percentile(obs.latencies_ms, 0.99),
+                obs.latencies_ms.empty() ? 0.0 : obs.latencies_ms.back());
+    std::printf("polls %llu  failed %llu\n",
+                static_cast<unsigned long long>(obs.polls), static_cast<unsigned long long>(obs.poll_failures));
+    if (!before.is_discarded() && !after.is_discarded()) {
+        std::printf("server: received %llu  dropped %llu  applied %llu\n",
+                    static_cast<unsigned long long>(counter(after, "received") - counter(before, "received")),
+                    static_cast<unsigned long long>(counter(after, "dropped") - counter(before, "dropped")),
+                    static_cast<unsigned long long>(counter(after, "applied") - counter(before, "applied")));
+    }
+    return obs.timeouts == 0 ? 0 : 1;
+}
@@ -1,6 +1,9 @@
 #pragma once
 #include <crow.h>
 #include "repo.hpp"
+#include "mqtt_ingestor.hpp"
+#include "room_broadcaster.hpp"
 
 // Registers all routes on the given app.
-void register_routes(crow::SimpleApp& app, Repo& repo);
+void register_routes(crow::SimpleApp& app, Repo& repo, const MqttIngestor& ingestor,
+                     RoomBroadcaster& broadcaster);
@@ -0,0 +1,21 @@
+// include/compress.hpp
+#pragma once
+#include <string>
+#include <string_view>
+
+// Content-Encoding of a response body.
+enum class Encoding { Identity, Gzip, Brotli };
+
+// "gzip", "br" or "" (identity), for the Content-Encoding header.
+const char* encoding_name(Encoding e);
+
+// Best encoding the client accepts, from an Accept-Encoding header value:
+// brotli (if built in) over gzip over identity; "q=0" excludes a coding,
+// and "*" stands for any coding the header does not name.
+Encoding negotiate_encoding(std::string_view accept_encoding);
+
+// gzip-framed deflate; empty on failure.
+std::string gzip_compress(std::string_view data, int level = 6);
+
+// Brotli; empty on failure or when built without it (SUCTION_HAVE_BROTLI).
+std::string brotli_compress(std::string_view data, int quality = 5);
@@ -0,0 +1,73 @@
+// include/device_liveness.hpp
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "timer_wheel.hpp"
+
+class Repo;
+
+struct LivenessOptions {
+    std::chrono::seconds      stale_after{90};   // silence before a room is flagged stale
+    std::chrono::milliseconds tick{1000};        // wheel resolution
+    std::size_t               wheel_slots = 512;
+};
+
+// Tracks when each room's sensor was last heard from and flags the room
+// stale in the Repo once it goes quiet for stale_after or reports itself
+// offline. Only rooms heard from since startup are tracked.
+//
+// Every tracked room has exactly one timer in a hashed wheel. Hearing from a
+// device only bumps its last-seen tick; when the timer fires it either
+// re-arms for the new deadline or flags the room, so each tick costs O(1)
+// amortized instead of a scan over all rooms.
+class DeviceLiveness {
+public:
+    explicit DeviceLiveness(Repo& repo, LivenessOptions opts = {});
+
+    DeviceLiveness(const DeviceLiveness&) = delete;
+    DeviceLiveness& operator=(const DeviceLiveness&) = delete;
+
+    // Start/stop the ticking thread (stop is safe to call multiple times).
+    void start();
+    void stop();
+
+    // The room's device is alive (a live state message or an "online" status).
+    void seen(int room_id);
+    // The room's device said it is gone ("offline" status, usually its LWT).
+    void offline(int room_id);
+
+    // Advance the wheel to "now" and flag anything that expired.
+    void tick();
+
+    ~DeviceLiveness();
+
+private:
+    struct Device {
+        std::uint64_t last_seen = 0; // tick
+        bool stale = false;
+        bool armed = false;          // has an entry in the wheel
+    };
+
+    std::uint64_t current_tick() const;
+    void loop();
+
+    Repo&           repo_;
+    LivenessOptions opts_;
+    std::uint64_t   stale_ticks_;
+    const std::chrono::steady_clock::time_point origin_;
+
+    std::mutex                      mtx_; // guards devices_ and wheel_
+    std::unordered_map<int, Device> devices_;
+    TimerWheel                      wheel_;
+
+    std::mutex              thread_mtx_;
+    std::condition_variable cv_;
+    bool                    stop_ = false;
+    std::thread             thread_;
+};
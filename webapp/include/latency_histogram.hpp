@@ -0,0 +1,108 @@
+// include/latency_histogram.hpp
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Lock-free log-linear histogram in the style of HdrHistogram: values below
+// kSub are exact, above that every power of two is split into kSub/2 equal
+// buckets, so any recorded value is reported within 1/64 (~1.6%) of itself.
+// Covers 0 .. 2^40 (about 12 days in microseconds); larger values clamp.
+// record() is a relaxed fetch_add and safe from any thread; readers see an
+// approximate but monotonic view.
+class LatencyHistogram {
+public:
+    static constexpr int         kSubBits = 7;
+    static constexpr std::size_t kSub     = std::size_t{1} << kSubBits; // 128
+    static constexpr std::size_t kHalf    = kSub / 2;
+    static constexpr int         kMaxBits = 40;
+    static constexpr std::size_t kBuckets = kSub + (kMaxBits - kSubBits + 1) * kHalf;
+
+    LatencyHistogram() : counts_(std::make_unique<std::atomic<std::uint64_t>[]>(kBuckets)) {}
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(std::uint64_t v) {
+        counts_[index(v)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(v, std::memory_order_relaxed);
+        std::uint64_t m = max_.load(std::memory_order_relaxed);
+        while (v > m && !max_.compare_exchange_weak(m, v, std::memory_order_relaxed)) {}
+    }
+
+    std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    std::uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    std::uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    double mean() const {
+        const std::uint64_t n = count();
+        return n ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / static_cast<double>(n) : 0.0;
+    }
+
+    // Smallest bucket bound at or below which a fraction p (0..1) of the
+    // values fall; 0 when empty.
+    std::uint64_t percentile(double p) const {
+        std::uint64_t total = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i) total += counts_[i].load(std::memory_order_relaxed);
+        if (total == 0) return 0;
+        auto target = static_cast<std::uint64_t>(p * static_cast<double>(total) + 0.5);
+        if (target == 0) target = 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= target) {
+                const std::uint64_t hi = highest_in(i);
+                const std::uint64_t m = max();
+                return hi < m ? hi : m;
+            }
+        }
+        return max();
+    }
+
+    // How many values are at most each of `bounds` (ascending), then the
+    // total, from one pass. A bucket that straddles a bound counts above it,
+    // so each answer is exact to within the histogram's resolution.
+    template <std::size_t N>
+    std::array<std::uint64_t, N + 1> cumulative(const std::array<std::uint64_t, N>& bounds) const {
+        std::array<std::uint64_t, N + 1> out{};
+        std::size_t b = 0;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            while (b < N && highest_in(i) > bounds[b]) out[b++] = seen;
+            seen += counts_[i].load(std::memory_order_relaxed);
+        }
+        while (b < N) out[b++] = seen;
+        out[N] = seen;
+        return out;
+    }
+
+private:
+    static std::size_t index(std::uint64_t v) {
+        if (v < kSub) return static_cast<std::size_t>(v);
+        int msb = 63 - std::countl_zero(v);
+        if (msb > kMaxBits) {
+            msb = kMaxBits;
+            v = (std::uint64_t{1} << (kMaxBits + 1)) - 1;
+        }
+        const int shift = msb - (kSubBits - 1); // leaves v >> shift in [kHalf, kSub)
+        return kSub + static_cast<std::size_t>(shift - 1) * kHalf +
+               static_cast<std::size_t>((v >> shift) - kHalf);
+    }
+
+    static std::uint64_t highest_in(std::size_t i) {
+        if (i < kSub) return i;
+        const std::size_t k = i - kSub;
+        const int shift = static_cast<int>(k / kHalf) + 1;
+        const std::uint64_t low = static_cast<std::uint64_t>(k % kHalf + kHalf) << shift;
+        return low + (std::uint64_t{1} << shift) - 1;
+    }
+
+    std::unique_ptr<std::atomic<std::uint64_t>[]> counts_;
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> max_{0};
+};
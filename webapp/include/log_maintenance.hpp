@@ -0,0 +1,48 @@
+// include/log_maintenance.hpp
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+class Repo;
+
+struct MaintenanceOptions {
+    std::chrono::seconds interval{300};       // time between passes
+    std::chrono::hours   retention{24 * 30};  // raw suction_log kept this long
+    int                  delete_batch = 1000; // rows per prune transaction
+};
+
+// Background job that keeps suction_log bounded: rolls complete hours into
+// suction_hourly, then deletes raw rows that are both rolled up and older
+// than the retention window.
+class LogMaintenance {
+public:
+    explicit LogMaintenance(Repo& repo, MaintenanceOptions opts = {});
+
+    LogMaintenance(const LogMaintenance&) = delete;
+    LogMaintenance& operator=(const LogMaintenance&) = delete;
+
+    // Start the periodic pass on a background thread (first pass runs immediately).
+    void start();
+
+    // Wake and join the thread (safe to call multiple times).
+    void stop();
+
+    // One rollup + prune pass on the calling thread.
+    void run_once();
+
+    ~LogMaintenance();
+
+private:
+    void loop();
+
+    Repo&              repo_;
+    MaintenanceOptions opts_;
+
+    std::mutex              mtx_;
+    std::condition_variable cv_;
+    bool                    stop_ = false;
+    std::thread             thread_;
+};
@@ -0,0 +1,172 @@
+// include/metrics.hpp
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "latency_histogram.hpp"
+
+// Process-wide counters and histograms, exposed in Prometheus text format at
+// GET /metrics.
+//
+// Recording never locks and never shares a cache line between threads: each
+// metric keeps kMetricShards cache-line-sized slots, each thread is given one
+// slot the first time it records, and an update is a single relaxed fetch_add
+// on it. Reading sums the slots, so a scrape sees every update that finished
+// before it, give or take the ones racing with it.
+//
+// Metrics are registered once (usually in a constructor) and the returned
+// reference is kept; registering the same name and labels again returns the
+// same metric.
+
+inline constexpr std::size_t kMetricShards = 32;
+
+// This thread's slot, assigned round-robin on first use.
+inline std::size_t metric_shard() {
+    static std::atomic<std::size_t> next{0};
+    thread_local const std::size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+class Counter {
+public:
+    Counter() : slots_(std::make_unique<Slot[]>(kMetricShards)) {}
+
+    void inc(std::uint64_t n = 1) {
+        slots_[metric_shard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t value() const {
+        std::uint64_t total = 0;
+        for (std::size_t i = 0; i < kMetricShards; ++i) total += slots_[i].value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> value{0};
+    };
+    std::unique_ptr<Slot[]> slots_;
+};
+
+// Durations in fixed buckets from 100 ns to 10 s (1-2.5-5 steps), which is
+// what Prometheus' histogram_quantile() works from.
+class Histogram {
+public:
+    static constexpr std::array<std::uint64_t, 25> kBoundsNs = {
+        100, 250, 500,
+        1'000, 2'500, 5'000, 10'000, 25'000, 50'000, 100'000, 250'000, 500'000,
+        1'000'000, 2'500'000, 5'000'000, 10'000'000, 25'000'000, 50'000'000,
+        100'000'000, 250'000'000, 500'000'000,
+        1'000'000'000, 2'500'000'000, 5'000'000'000, 10'000'000'000,
+    };
+    static constexpr std::size_t kBuckets = kBoundsNs.size() + 1; // last one is +Inf
+
+    Histogram() : slots_(std::make_unique<Slot[]>(kMetricShards)) {}
+
+    void observe_ns(std::uint64_t ns) {
+        const auto bucket = static_cast<std::size_t>(
+            std::lower_bound(kBoundsNs.begin(), kBoundsNs.end(), ns) - kBoundsNs.begin());
+        Slot& slot = slots_[metric_shard()];
+        slot.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        slot.sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    void observe(std::chrono::steady_clock::duration d) {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        observe_ns(ns > 0 ? static_cast<std::uint64_t>(ns) : 0);
+    }
+
+    // Per-bucket (not cumulative) counts and the sum, over every slot.
+    struct Totals {
+        std::array<std::uint64_t, kBuckets> buckets{};
+        std::uint64_t sum_ns = 0;
+    };
+    Totals totals() const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> buckets[kBuckets]{};
+        std::atomic<std::uint64_t> sum_ns{0};
+    };
+    std::unique_ptr<Slot[]> slots_;
+};
+
+// Records the lifetime of the scope into a histogram.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& h) : h_(h), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { h_.observe(std::chrono::steady_clock::now() - start_); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& h_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Locks `m` and records how long that took; an uncontended lock records 0
+// without reading the clock.
+template <class Mutex>
+std::unique_lock<Mutex> timed_lock(Mutex& m, Histogram& wait) {
+    std::unique_lock<Mutex> lk(m, std::try_to_lock);
+    if (lk.owns_lock()) {
+        wait.observe_ns(0);
+    } else {
+        const auto start = std::chrono::steady_clock::now();
+        lk.lock();
+        wait.observe(std::chrono::steady_clock::now() - start);
+    }
+    return lk;
+}
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+class MetricsRegistry {
+public:
+    Counter& counter(std::string_view name, std::string_view help, const MetricLabels& labels = {});
+    Histogram& histogram(std::string_view name, std::string_view help, const MetricLabels& labels = {});
+
+    // Every metric, in registration order (text exposition format 0.0.4).
+    std::string render() const;
+
+private:
+    struct Series {
+        std::string labels; // rendered: name="value",...
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Histogram> histogram;
+    };
+    struct Family {
+        std::string name;
+        std::string help;
+        bool is_histogram = false;
+        std::vector<Series> series;
+    };
+
+    Series& series(std::string_view name, std::string_view help, bool is_histogram, const MetricLabels& labels);
+
+    mutable std::mutex mtx_; // registration and render() only
+    std::vector<std::unique_ptr<Family>> families_;
+};
+
+MetricsRegistry& metrics();
+
+// Appends one unlabelled gauge sample, for values read at scrape time.
+void write_gauge(std::string& out, std::string_view name, std::string_view help, double value);
+
+// Appends LatencyHistograms holding microseconds (e.g. IngestLatency) as one
+// histogram family in seconds, one series per value of `label`, on the same
+// le bounds as Histogram so every duration on /metrics lines up.
+using LatencySeries = std::vector<std::pair<std::string_view, const LatencyHistogram*>>;
+void write_latency_histograms(std::string& out, std::string_view name, std::string_view help,
+                              std::string_view label, const LatencySeries& series);
@@ -1,11 +1,12 @@
 #pragma once
+#include <cstdint>
 #include <string>
 
 using namespace std;
 
 /*
 This file contains the structs used for our application
-Operating Room, Room Event
+Operating Room, Room Event, Hourly Usage, Suction Event
 */
 
 // ───────────────────────────────────────────────
@@ -17,6 +18,7 @@ struct OperatingRoom {
     string procedure;
     string schedule;
     bool suction_on;
+    bool stale = false; // sensor silent or offline; suction_on may be out of date
 };
 // ───────────────────────────────────────────────
 // Struct representing a room event
@@ -26,4 +28,20 @@ struct RoomEvent {
     string start_time;
     string end_time;
     bool active;
-};
\ No newline at end of file
+};
+// ───────────────────────────────────────────────
+// Struct representing one hour of suction usage
+// ───────────────────────────────────────────────
+struct HourlyUsage {
+    int64_t hour;      // Unix seconds at the top of the hour
+    int on_seconds;
+    int transitions;
+};
+// ───────────────────────────────────────────────
+// Struct representing one suction_log transition
+// ───────────────────────────────────────────────
+struct SuctionEvent {
+    int64_t id;
+    bool suction_on;
+    int64_t timestamp; // Unix seconds
+};
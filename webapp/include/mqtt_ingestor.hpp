@@ -2,14 +2,92 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "device_liveness.hpp"
+#include "latency_histogram.hpp"
+#include "metrics.hpp"
+#include "mpsc_ring.hpp"
+#include "seq_tracker.hpp"
+#include "state_payload.hpp"
 
 // Forward declarations to keep this header lightweight.
 // (Definitions live in the .cpp)
 class Repo;
 struct mosquitto;
 
+// What the mosquitto callback does when the ingest queue is full.
+enum class OverflowPolicy {
+    DropOldest, // evict the oldest queued message (newest state wins)
+    DropNewest, // discard the incoming message
+    Block,      // wait for room (stalls the network loop; backpressure)
+};
+
+struct IngestOptions {
+    std::size_t    queue_capacity = 4096; // per worker; rounded up to a power of two
+    OverflowPolicy overflow       = OverflowPolicy::DropOldest;
+    // After the first message of a burst, how long to keep collecting before
+    // writing; only the newest state per room within it reaches the Repo.
+    std::chrono::milliseconds coalesce_window{25};
+    // Ingest workers, each one mosquitto client plus one consumer shard.
+    std::size_t    workers = 1;
+    // Client ids are "<client_id>-<pid>-<n>", unique per worker and process.
+    std::string    client_id = "suction-ingestor";
+    // Subscribe as "$share/<group>/<filter>" so the broker splits messages
+    // across every client in the group (this process's workers and any other
+    // ingestor). Empty means a plain subscription, unless workers > 1, which
+    // implies the group "suction-ingest". Brokers never send retained
+    // messages to shared subscriptions, so a shared ingestor also runs one
+    // replay client on the plain filters that only takes retained messages.
+    std::string    share_group;
+    // Compact binary state (state_codec.h) from firmware built with
+    // PAYLOAD_BINARY; empty disables it.
+    std::string     binary_filter = "suction/+/state/bin";
+    // Device status ({"status":"online"|"offline"}, retained + LWT) feeding
+    // stale-room detection; empty disables it.
+    std::string     status_filter = "suction/+/status";
+    LivenessOptions liveness;
+};
+
+// Point-in-time view of one worker (or, from stats(), all of them summed).
+struct IngestStats {
+    std::size_t   depth;
+    std::size_t   capacity;
+    std::size_t   high_water;
+    std::uint64_t received;   // parsed by this worker's client and offered to a shard
+    std::uint64_t dropped;    // lost to the overflow policy on this worker's shard
+    std::uint64_t processed;  // taken off this worker's shard
+    std::uint64_t coalesced;  // superseded by a newer message for the room in the same window
+    std::uint64_t duplicates; // same as the room's current state; dropped before any DB access
+    std::uint64_t applied;    // reached Repo::update_suction
+    std::uint64_t seq_gaps;     // messages missing between consecutive seqs of a room
+    std::uint64_t out_of_order; // seq not newer than the room's last one; discarded
+    std::uint64_t seq_resets;   // seq went back because the device restarted (see SeqTracker)
+};
+
+// Time from a state message's arrival at an MQTT client to each later stage,
+// in microseconds, across all workers. `device` instead runs from the
+// payload's ts to arrival, and is only recorded when ts is a Unix time in ms
+// (a device clock since boot cannot be compared).
+struct IngestLatency {
+    LatencyHistogram device;    // device ts -> received
+    LatencyHistogram parsed;    // received -> parsed and queued
+    LatencyHistogram visible;   // received -> in the snapshot served by /api/rooms
+    LatencyHistogram committed; // received -> committed to SQLite
+};
+
+struct WorkerStats {
+    std::string client_id;
+    bool        connected;
+    IngestStats ingest;
+};
+
 class MqttIngestor {
 public:
     // Construct with broker info and a topic filter like "suction/+/state".
@@ -17,7 +95,8 @@ public:
                  std::string broker_host = "localhost",
                  int broker_port = 1883,
                  std::string topic_filter = "suction/+/state",
-                 int qos = 1);
+                 int qos = 1,
+                 IngestOptions options = {});
 
     // Non-copyable, movable (optional—enable if you want)
     MqttIngestor(const MqttIngestor&) = delete;
@@ -25,23 +104,93 @@ public:
     MqttIngestor(MqttIngestor&&) = delete;
     MqttIngestor& operator=(MqttIngestor&&) = delete;
 
-    // Start the MQTT loop in a background thread.
+    // Start every worker's MQTT loop and consumer on background threads.
     // Returns false if initialization/connection failed.
     bool start();
 
     // Stop the loop and clean up resources (safe to call multiple times).
     void stop();
 
+    IngestStats stats() const;
+    std::vector<WorkerStats> worker_stats() const;
+    const IngestLatency& latency() const { return latency_; }
+
     ~MqttIngestor();
 
 private:
-    // mosquitto callbacks (registered per-connection)
+    // mosquitto callbacks (registered per-connection; userdata is the Worker)
     static void on_connect(struct mosquitto* m, void* userdata, int rc);
     static void on_disconnect(struct mosquitto* m, void* userdata, int rc);
     static void on_message(struct mosquitto* m, void* userdata, const struct mosquitto_message* msg);
 
-    // Helper to parse "suction/<room>/state" → "<room>"
-    static std::string extract_room_from_topic(const std::string& topic);
+    // One parsed message on its way from the network thread to the Repo.
+    // Fixed-size so queuing it never allocates.
+    struct Update {
+        enum class Kind : std::uint8_t { State, Online, Offline };
+
+        static constexpr std::size_t kMaxRoom = kMaxRoomName;
+        char room[kMaxRoom];
+        std::uint8_t room_len = 0;
+        Kind kind = Kind::State;
+        bool suction_on = false;
+        bool retained = false; // broker replay of an old message, not a sign of life
+        bool has_seq = false;
+        std::uint32_t seq = 0;
+        bool has_uptime = false; // ts was a device clock since boot
+        std::uint64_t uptime_ms = 0;
+        std::chrono::steady_clock::time_point received_at;
+
+        std::string_view room_number() const { return {room, room_len}; }
+    };
+
+    // A mosquitto client and the consumer shard that owns a slice of rooms.
+    // Any worker's client may receive any room (the broker decides); the
+    // message is then routed to the shard that owns the room, so each room
+    // is only ever written by one consumer thread, in arrival order.
+    struct Worker {
+        explicit Worker(MqttIngestor& owner, std::size_t capacity) : owner(owner), queue(capacity) {}
+
+        MqttIngestor&     owner;
+        std::string       client_id;
+        bool              replay = false; // the retained-only client; has no shard of its own
+        struct mosquitto* mosq = nullptr;
+        std::thread       loop_thread;
+        std::atomic<bool> connected{false};
+
+        MpscRing<Update>           queue;
+        std::thread                consumer_thread;
+        std::atomic<std::uint32_t> wake{0}; // bumped on every push; the consumer waits on it
+
+        std::atomic<std::uint64_t> received{0};
+        std::atomic<std::uint64_t> dropped{0};
+        std::atomic<std::uint64_t> processed{0};
+        std::atomic<std::uint64_t> coalesced{0};
+        std::atomic<std::uint64_t> duplicates{0};
+        std::atomic<std::uint64_t> applied{0};
+        std::atomic<std::uint64_t> seq_gaps{0};
+        std::atomic<std::uint64_t> out_of_order{0};
+        std::atomic<std::uint64_t> seq_resets{0};
+        std::atomic<std::size_t>   high_water{0};
+
+        // Consumer thread only: newest state per room id for the current window
+        // (-1 = nothing pending, else kOn | kFresh bits) and the ids touched,
+        // in first-seen order.
+        std::vector<std::int8_t> pending;
+        std::vector<std::chrono::steady_clock::time_point> pending_at; // its received_at
+        std::vector<int>         touched;
+        // Per-room seq ordering, by room id.
+        SeqTracker seq;
+    };
+
+    Worker& shard_for(std::string_view room_number);
+    void enqueue(Worker& shard, Update& u); // network thread: never touches the Repo
+    void consume_loop(Worker& w);           // consumer thread: drains into the Repo
+    void collect(Worker& w, const Update& u);
+    bool accept_seq(Worker& w, std::size_t slot, const Update& u);
+    void apply_pending(Worker& w);
+    bool connect_client(Worker& w);
+    std::vector<Worker*> clients(); // every worker, then the replay client
+    void destroy_clients();
 
 private:
     Repo& repo_;
@@ -50,7 +199,25 @@ private:
     std::string topic_;
     int         qos_;
 
-    struct mosquitto* mosq_ = nullptr;
-    std::thread       loop_thread_;
-    std::atomic<bool> running_{false};
+    IngestOptions                        options_;
+    std::string                          subscription_; // topic_, maybe behind $share/<group>/
+    std::vector<std::string>             extra_subscriptions_; // binary and status filters, if enabled
+    std::vector<std::unique_ptr<Worker>> workers_;
+    // Plain subscriptions for retained state and status, when workers_ share
+    // theirs; the messages go to the owning worker's shard like any other.
+    std::unique_ptr<Worker>              replay_;
+    std::vector<std::string>             replay_subscriptions_;
+    DeviceLiveness                       liveness_;
+    IngestLatency                        latency_;
+
+    // Process-wide, in metrics() (GET /metrics).
+    struct Counters {
+        Counter& received;   // every message the broker delivered
+        Counter& parsed;     // understood and queued
+        Counter& failed;     // malformed topic or payload; dropped
+        Counter& reconnects; // unexpected disconnects, which mosquitto then retries
+    };
+    Counters                             counters_;
+    std::atomic<bool>                    running_{false};
+    std::atomic<bool>                    consuming_{false};
 };
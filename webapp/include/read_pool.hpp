@@ -0,0 +1,64 @@
+#pragma once
+#include <sqlite3.h>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "stmt_cache.hpp"
+
+// Read-only connections to the same database as Repo's writer.
+// With journal_mode=WAL each one reads a consistent snapshot without waiting
+// on the writer, so HTTP threads never queue behind an ingest commit.
+class ReadPool {
+private:
+    struct Conn {
+        sqlite3* db = nullptr;
+        std::unique_ptr<StmtCache> stmts;
+    };
+
+public:
+    // A connection checked out by one thread; returned when the lease dies.
+    class Lease {
+    public:
+        Lease(ReadPool& pool, Conn* conn) : pool_(&pool), conn_(conn) {}
+        Lease(Lease&& o) noexcept : pool_(o.pool_), conn_(std::exchange(o.conn_, nullptr)) {}
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+        ~Lease() { if (conn_) pool_->release(conn_); }
+
+        // False only when the pool has no connections at all.
+        explicit operator bool() const { return conn_ != nullptr; }
+
+        sqlite3* db() const { return conn_->db; }
+        StmtCache& stmts() const { return *conn_->stmts; }
+
+    private:
+        ReadPool* pool_;
+        Conn* conn_;
+    };
+
+    // size 0 picks one connection per hardware thread (Crow's worker count).
+    ReadPool(const std::string& db_path, std::size_t size);
+    ~ReadPool();
+
+    ReadPool(const ReadPool&) = delete;
+    ReadPool& operator=(const ReadPool&) = delete;
+
+    std::size_t size() const { return conns_.size(); }
+
+    // Blocks while every connection is checked out.
+    // Returns an empty lease if no connection could be opened.
+    Lease acquire();
+
+private:
+    void release(Conn* conn);
+
+    std::vector<Conn> conns_;
+    std::vector<Conn*> idle_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+};
@@ -1,14 +1,66 @@
 #pragma once
 #include <sqlite3.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
+#include "metrics.hpp"
 #include "models.hpp"
+#include "read_pool.hpp"
+#include "schedule_index.hpp"
+#include "stmt_cache.hpp"
+
+// Batching limits for suction writes (see Repo::update_suction).
+struct WriteBehindOptions {
+    std::size_t max_batch = 256;              // updates committed per transaction
+    std::chrono::milliseconds max_delay{20};  // how long the oldest update may wait
+};
+
+// What changed after a given state version (see Repo::changes_since).
+struct RoomChanges {
+    std::uint32_t epoch = 0;   // Repo::epoch() the version belongs to
+    std::uint64_t version = 0; // state version `rooms` is current as of
+    std::int64_t minute = 0;   // Unix minute schedules were resolved at
+    bool full = false;         // the journal did not reach back far enough: every room
+    std::vector<OperatingRoom> rooms;
+};
+
+// One item of Repo::update_suction_batch().
+struct SuctionUpdate {
+    int room_id = 0;
+    bool suction_on = false;
+    std::int64_t timestamp = 0; // Unix seconds
+};
+
+// What update_suction_batch() did with each item.
+enum class SuctionUpdateStatus {
+    Applied,
+    UnknownRoom,
+    RolledUp,   // falls in an hour already folded into suction_hourly
+    OutOfOrder, // older than the room's last recorded update
+    InFuture,   // more than a minute ahead of the server clock
+    Failed,     // the transaction did not commit; nothing was applied
+};
 
 class Repo {
 public:
-    explicit Repo(const std::string& db_path);
-    ~Repo();
+    // read_connections: size of the read-only pool (0 = one per hardware thread).
+    explicit Repo(const std::string& db_path,
+                  WriteBehindOptions write_behind = {},
+                  std::size_t read_connections = 0);
+    ~Repo(); // drains queued writes
 
     // non-copyable
     Repo(const Repo&) = delete;
@@ -20,25 +72,200 @@ public:
     void seed_if_empty();
 
     // Queries
+    // Served from the in-memory snapshot: no SQL and no mutex on the read path
+    // (except once per day, when today's schedules are reloaded).
     std::vector<OperatingRoom> load_rooms();
+    // Bumped after every change to what load_rooms() returns, other than the
+    // passage of time (schedule windows); starts at 1.
+    std::uint64_t state_version() const { return version_.load(std::memory_order_acquire); }
+    // Random and non-zero, fixed for this Repo's lifetime. Versions restart
+    // at 1 in every process, so a version only means something together with
+    // the epoch it was handed out under.
+    std::uint32_t epoch() const { return epoch_; }
+
+    // One room, the same way; nullopt for an unknown id.
+    std::optional<OperatingRoom> load_room(int room_id);
+
+    // Rooms written after state version `since` (from the change journal),
+    // plus, given the Unix minute the caller last resolved schedules at, rooms
+    // whose procedure window has moved on since. Pass back the result's
+    // epoch, version and minute next time. Every room, with full set, if
+    // `epoch` is not this Repo's (another process, or 0) or `since` is older
+    // than the journal.
+    RoomChanges changes_since(std::uint32_t epoch, std::uint64_t since, std::int64_t since_minute = 0);
+
+    // Called whenever the snapshot changes, with the room that changed (0 =
+    // all of them, e.g. the daily schedule reload). Runs under the snapshot
+    // lock, so it must be quick and must not call back into the Repo.
+    using ChangeListener = std::function<void(int room_id)>;
+    void set_change_listener(ChangeListener listener);
 
     // Mutations
-    void update_suction(int room_id, bool suction_on);
+    // Visible to load_rooms() immediately; the DB write is queued and committed
+    // in a batch by the flusher thread. `origin` (e.g. when the MQTT message
+    // arrived) is handed to the commit observer once the write is durable.
+    void update_suction(int room_id, bool suction_on,
+                        std::chrono::steady_clock::time_point origin = {});
+    // Applies many updates, each with its own timestamp, in timestamp order and
+    // in one transaction: the accepted ones commit together (and only then
+    // reach the snapshot) or not at all. Returns a status per update, in the
+    // caller's order. Drains the write-behind queue first, so it checks
+    // against everything already accepted; update_suction() waits meanwhile.
+    std::vector<SuctionUpdateStatus> update_suction_batch(const std::vector<SuctionUpdate>& updates);
+    // Called on the flusher thread, after each batch commits, with the origin
+    // of every update in it that had one.
+    using CommitObserver = std::function<void(std::chrono::steady_clock::time_point origin)>;
+    void set_commit_observer(CommitObserver observer);
+    // The room's current suction state as update_suction() left it, from the
+    // snapshot (no SQL, no lock); nullopt for an unknown room.
+    std::optional<bool> suction_state(int room_id) const;
+    // The room's sensor re-reported the state it already has, so nothing is
+    // written; update_suction_batch() still treats items stamped before now
+    // as out of order, as if the state had been written again.
+    void confirm_suction(int room_id);
+    // Marks a room's sensor as silent/offline (or back); shown by load_rooms().
+    void set_room_stale(int room_id, bool stale);
     void insert_room(const OperatingRoom& r);
 
     //map something like "OR 3" → rooms.id
-    int ensure_room_id(const std::string& room_number);
+    int ensure_room_id(std::string_view room_number);
+    // The id of an existing room, or 0; never creates one.
+    int find_room_id(std::string_view room_number);
+
+    // Blocks until every update_suction() issued before the call is committed.
+    void flush();
+
+    // suction_log retention (driven by LogMaintenance)
+    // Folds every complete hour before `now` into suction_hourly, one room per
+    // transaction. Returns how many rooms advanced.
+    int rollup_hourly(std::int64_t now);
+    // Deletes already-rolled-up suction_log rows older than `cutoff`, at most
+    // `batch` per transaction. Returns the number of rows deleted.
+    std::size_t prune_suction_log(std::int64_t cutoff, int batch);
+    // Usage per hour in [from, to): rolled-up hours come from suction_hourly,
+    // later ones are folded from the raw log the same way.
+    std::vector<HourlyUsage> hourly_usage(int room_id, std::int64_t from, std::int64_t to);
+
+    // Up to `limit` transitions with timestamp in [from, to), ordered by
+    // (timestamp, id) and strictly after the (after_ts, after_id) cursor.
+    // Seeks on the index, so every page costs the same however deep it is.
+    std::vector<SuctionEvent> suction_history(int room_id, std::int64_t from, std::int64_t to,
+                                              std::int64_t after_ts, std::int64_t after_id,
+                                              int limit);
 
 private:
-    // helpers (locked within public API)
-    RoomEvent get_current_event_for_room(int room_id);
-    bool get_latest_suction_status(int room_id);
+    // One room as last written to the DB. Immutable once published.
+    struct RoomState {
+        int id = 0;
+        std::string room_number;
+        bool suction_on = false;
+        bool stale = false;     // sensor silent or offline (memory only, see DeviceLiveness)
+        ScheduleIndex schedule; // what runs on Snapshot::date, incl. the previous night's overrun
+    };
+
+    // Authoritative view of every room. Writers build a new Snapshot and swap
+    // it in; readers keep whichever one they loaded for as long as they need.
+    struct Snapshot {
+        int date = 0; // YYYYMMDD the schedules belong to
+        std::uint64_t version = 0; // state_version() once this was published
+        std::vector<std::shared_ptr<const RoomState>> rooms; // ordered by id
+    };
+
+    // A suction write waiting for the flusher.
+    struct PendingSuction {
+        std::uint64_t seq;
+        int room_id;
+        bool suction_on;
+        std::int64_t timestamp; // Unix seconds
+        std::chrono::steady_clock::time_point queued_at;
+        std::chrono::steady_clock::time_point origin; // default = not observed
+    };
+
+    // Runs f(StmtCache&) on a pooled read connection (on the writer, under
+    // mtx_, if the pool could not open any).
+    template <class F> auto with_reader(F&& f);
+    // Takes mtx_, recording the wait in writer_wait_.
+    std::unique_lock<std::mutex> lock_writer() { return timed_lock(mtx_, writer_wait_); }
+
+    // helpers (run on whichever connection owns `stmts`)
+    static std::vector<RoomState> read_room_states(StmtCache& stmts, int date, int room_id);
+    static RoomState read_room_state(StmtCache& stmts, int room_id, int date);
+
+    // helpers (caller holds mtx_)
+    void write_suction(int room_id, bool suction_on, std::int64_t timestamp);
     void log_suction_status(int room_id, bool suction_on);
 
-    void exec_ddl(const char* sql);
+    // room_number -> id cache (takes ids_mtx_ itself; rooms are never deleted)
+    int cached_room_id(std::string_view room_number);
+    void remember_room_id(std::string_view room_number, int room_id);
+
+    // Lets room_ids_ be probed with a string_view without building a string.
+    struct RoomNumberHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    // snapshot maintenance (caller holds snap_mtx_ unless noted)
+    std::shared_ptr<const Snapshot> snapshot_for(int today); // takes snap_mtx_ on a new day
+    static OperatingRoom to_operating_room(const RoomState& state, int minute_now);
+    static std::shared_ptr<const RoomState> find_room(const Snapshot& snap, int room_id);
+    void rebuild_snapshot(int date);
+    void publish_room(RoomState room);
+    void refresh_room(int room_id); // takes snap_mtx_ itself
+    void record_change(std::uint64_t version, int room_id); // before the snapshot is stored
+
+    // write-behind
+    void flush_loop();
+    bool apply_suction_batch(const std::vector<PendingSuction>& batch); // false if the COMMIT failed
+
+    bool exec_ddl(const char* sql);
+    bool migrate_to(int to, const std::vector<const char*>& steps);
+    int schema_version();
     void init_schema();
 
 private:
-    sqlite3* db_{nullptr};
-    std::mutex mtx_;
+    sqlite3* db_{nullptr};             // the only writer
+    std::unique_ptr<StmtCache> stmts_; // guarded by mtx_
+    std::mutex mtx_;                   // the writer; never taken before snap_mtx_
+    Histogram& writer_wait_;           // time spent waiting for mtx_
+    std::unique_ptr<ReadPool> readers_;
+
+    std::mutex snap_mtx_;              // serializes snapshot writers
+    std::atomic<std::shared_ptr<const Snapshot>> snapshot_;
+    ChangeListener change_listener_;   // guarded by snap_mtx_
+    std::atomic<std::uint64_t> version_{1}; // written under snap_mtx_, after the snapshot
+    const std::uint32_t epoch_ = new_epoch();
+    static std::uint32_t new_epoch();
+
+    // Which room each snapshot swap changed (0 = all), newest last; bounded,
+    // so older versions fall back to a full answer in changes_since().
+    struct JournalEntry {
+        std::uint64_t version;
+        int room_id;
+    };
+    static constexpr std::size_t kJournalSize = 4096;
+    std::mutex journal_mtx_;            // leaf lock; taken under snap_mtx_ by writers
+    std::deque<JournalEntry> journal_;  // guarded by journal_mtx_
+    std::uint64_t journal_floor_ = 0;   // every change after this version is in journal_
+
+    std::mutex confirmed_mtx_;          // leaf lock
+    std::unordered_map<int, std::int64_t> confirmed_; // room -> last confirm_suction(), Unix seconds
+
+    std::shared_mutex ids_mtx_;        // leaf lock: nothing else is taken while held
+    std::unordered_map<std::string, int, RoomNumberHash, std::equal_to<>> room_ids_;
+
+    WriteBehindOptions wb_;
+    std::mutex queue_mtx_;
+    std::condition_variable queue_cv_;   // flusher: work arrived / flush requested
+    std::condition_variable flushed_cv_; // flush(): a batch was committed
+    std::deque<PendingSuction> queue_;
+    std::uint64_t queued_seq_ = 0;
+    // No update is queued with an earlier timestamp; rollup_hourly() raises it
+    // to its watermark so nothing can land behind an hour it already folded.
+    std::int64_t stamp_floor_ = 0;
+    std::uint64_t flushed_seq_ = 0;
+    int flush_waiters_ = 0;
+    CommitObserver commit_observer_;     // guarded by queue_mtx_
+    bool stop_ = false;
+    std::thread flusher_;
 };
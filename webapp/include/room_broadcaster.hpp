@@ -0,0 +1,74 @@
+// include/room_broadcaster.hpp
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class Repo;
+
+// Pushes room changes to every connected dashboard (see /api/rooms/stream).
+//
+// The Repo's change listener only records which rooms changed; a sender
+// thread then renders each changed room once from the snapshot and hands the
+// same message to every subscriber, so the cost of a change does not grow
+// with the number of open browsers beyond the send itself. Changes that land
+// while a send is in progress are merged into the next message.
+//
+// Messages (JSON text):
+//   {"type":"rooms","rooms":[...],"generatedAt":".."}  on subscribe and each minute
+//   {"type":"delta","rooms":[...],"generatedAt":".."}   rooms that changed
+//
+// Lock order: subs_mtx_ -> Repo's locks -> mtx_. The sender never holds mtx_
+// while taking another lock.
+class RoomBroadcaster {
+public:
+    // Delivers one message; must not block (e.g. queue it on the connection).
+    // Called on the sender thread (or the subscriber's, from subscribe()),
+    // never concurrently for one subscriber.
+    using Send = std::function<void(const std::string& message)>;
+
+    explicit RoomBroadcaster(Repo& repo);
+    ~RoomBroadcaster();
+
+    RoomBroadcaster(const RoomBroadcaster&) = delete;
+    RoomBroadcaster& operator=(const RoomBroadcaster&) = delete;
+
+    // Becomes the Repo's change listener and starts the sender thread.
+    void start();
+    // Stops the sender and detaches from the Repo (safe to call twice).
+    void stop();
+
+    // Sends the full room list to the new subscriber, then deltas. `key`
+    // identifies it for unsubscribe(); once that returns, `send` is not called again.
+    void subscribe(const void* key, Send send);
+    void unsubscribe(const void* key);
+    std::size_t subscribers() const;
+
+    std::uint64_t messages_sent() const; // per subscriber, summed
+
+private:
+    void room_changed(int room_id); // Repo listener; 0 = all rooms
+    void loop();
+    std::string full_message() const;
+    void send_all(const std::string& message); // caller holds subs_mtx_
+
+    Repo& repo_;
+
+    mutable std::mutex subs_mtx_; // held while sending, so unsubscribe() waits out a send
+    std::unordered_map<const void*, Send> subs_;
+    std::uint64_t sent_ = 0;      // guarded by subs_mtx_
+
+    std::mutex mtx_;              // guards everything below
+    std::condition_variable cv_;
+    std::vector<int> changed_;    // room ids, possibly repeated
+    bool all_changed_ = false;
+    bool stop_ = false;
+    std::thread thread_;
+};
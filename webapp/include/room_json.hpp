@@ -0,0 +1,10 @@
+#pragma once
+#include <crow.h>
+#include <vector>
+#include "models.hpp"
+
+// The JSON shape of a room, shared by /api/rooms and the push stream.
+crow::json::wvalue room_to_json(const OperatingRoom& room);
+
+// {"rooms":[...], "generatedAt":"..."}
+crow::json::wvalue rooms_to_json(const std::vector<OperatingRoom>& rooms);
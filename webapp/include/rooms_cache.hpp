@@ -0,0 +1,61 @@
+// include/rooms_cache.hpp
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "compress.hpp"
+
+class Repo;
+
+// One serialized /api/rooms body. Immutable once published; the compressed
+// forms are produced on first use (once each) and then shared as well.
+class RoomsBody {
+public:
+    RoomsBody(std::uint32_t epoch, std::uint64_t version, std::int64_t minute, std::string json);
+
+    std::uint64_t version() const { return version_; }
+    std::int64_t minute() const { return minute_; }
+    const std::string& etag() const { return etag_; }
+
+    // The body in `e`; falls back to identity (and sets `e` to say so) when
+    // that form is unavailable or no smaller.
+    const std::string& encoded(Encoding& e) const;
+
+private:
+    std::uint64_t version_;
+    std::int64_t  minute_;
+    std::string   etag_;
+    std::string   json_;
+
+    mutable std::once_flag gzip_once_;
+    mutable std::once_flag brotli_once_;
+    mutable std::string    gzip_;
+    mutable std::string    brotli_;
+};
+
+// Caches the /api/rooms body per Repo state version and minute (procedures
+// follow the clock), so concurrent requests for unchanged data share one
+// serialization instead of each walking the snapshot and building JSON.
+class RoomsResponseCache {
+public:
+    explicit RoomsResponseCache(Repo& repo) : repo_(repo) {}
+
+    // "<epoch>-<version>-<minute>", the ETag of what get() would return now.
+    // The Repo epoch keeps a tag from before a restart, whose versions
+    // started over, from matching a different body.
+    std::string current_etag() const;
+    static std::string make_etag(std::uint32_t epoch, std::uint64_t version, std::int64_t minute);
+
+    // The body for the current state; builds it if the cached one is stale.
+    // Requests that queue behind a build take its result rather than
+    // rebuilding, as long as it is no older than when they arrived.
+    std::shared_ptr<const RoomsBody> get();
+
+private:
+    Repo& repo_;
+    std::mutex build_mtx_; // one builder at a time
+    std::atomic<std::shared_ptr<const RoomsBody>> current_;
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One room's procedures for a single day, answering "what is active at
+// minute m" with a binary search. Windows are in minutes since local
+// midnight with an inclusive end; end < start means the window runs past
+// midnight into the next day.
+class ScheduleIndex {
+public:
+    struct Window {
+        std::string procedure;
+        int start_min;
+        int end_min;
+    };
+
+    // A window scheduled on the indexed day.
+    void add(Window w);
+    // A window scheduled on the day before; only its after-midnight part
+    // (if it crosses midnight) lands on the indexed day.
+    void add_carryover(Window w);
+
+    // Sorts and flattens the windows into disjoint slots. Call once after
+    // the last add; the index is read-only afterwards.
+    void build();
+
+    // The window active at `minute` or nullptr. Where windows overlap, the
+    // one that started first wins.
+    const Window* active_at(int minute) const;
+
+    bool empty() const { return windows_.empty(); }
+
+private:
+    struct Piece {
+        int from;
+        int to;            // inclusive
+        std::size_t window;
+    };
+
+    std::vector<Window> windows_;
+    std::vector<Piece> pieces_; // where each window falls on the indexed day
+    std::vector<Piece> slots_;  // disjoint, sorted by `from`
+};
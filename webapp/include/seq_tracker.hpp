@@ -0,0 +1,67 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Orders each room's state messages by the device's seq (a u32 counter that
+// starts at 0 after boot and may wrap). A message no newer than the last one
+// taken for its room is stale. The sensor publishes at QoS 0, so the seq-0
+// message after a reboot can be lost. A step back is therefore also taken as
+// a restart when:
+// - it is larger than any plausible reordering;
+// - the device's uptime (a ts that is a clock since boot) is shorter than
+//   the time since the room's last message, so it booted in between;
+// - or the room has been quiet for longer than reordering could span.
+// Not thread-safe; each room belongs to one consumer thread.
+class SeqTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::int32_t kReorderWindow = 1024;
+    static constexpr Clock::duration kReorderSpan = std::chrono::seconds(60);
+
+    enum class Verdict : std::uint8_t { Accept, Stale, Reset };
+    struct Result {
+        Verdict verdict;
+        std::uint32_t gap = 0; // seqs skipped before an accepted message
+    };
+
+    // `uptime_ms` is the payload's ts when it is a device clock since boot.
+    Result check(std::size_t room, std::uint32_t seq, std::optional<std::uint64_t> uptime_ms,
+                 Clock::time_point arrived) {
+        if (room >= last_.size()) last_.resize(room + 1);
+        Last& last = last_[room];
+        Result r{Verdict::Accept};
+        if (last.seq >= 0) {
+            // Serial-number arithmetic, so the counter may wrap.
+            const auto delta = static_cast<std::int32_t>(seq - static_cast<std::uint32_t>(last.seq));
+            const auto quiet = arrived - last.at;
+            // (A replay of the last message has the same uptime, not a lower one.)
+            const bool booted_since = uptime_ms && *uptime_ms < last.uptime_ms &&
+                std::chrono::milliseconds(*uptime_ms) < quiet;
+            if ((seq == 0 && last.seq != 0) || delta < -kReorderWindow ||
+                (delta <= 0 && booted_since) || (delta < 0 && quiet > kReorderSpan)) {
+                r.verdict = Verdict::Reset;
+            } else if (delta <= 0) {
+                return {Verdict::Stale};
+            } else {
+                r.gap = static_cast<std::uint32_t>(delta - 1);
+            }
+        }
+        last.seq = seq;
+        last.uptime_ms = uptime_ms.value_or(kUnknown);
+        last.at = arrived;
+        return r;
+    }
+
+private:
+    static constexpr std::uint64_t kUnknown = UINT64_MAX;
+    struct Last {
+        std::int64_t seq = -1; // none yet
+        std::uint64_t uptime_ms = kUnknown;
+        Clock::time_point at;  // arrival of that message
+    };
+    std::vector<Last> last_;
+};
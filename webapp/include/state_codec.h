@@ -0,0 +1,78 @@
+/* include/state_codec.h
+ *
+ * Binary suction state payload, shared by the ESP32 firmware (C) and the
+ * server (C++). Published on "suction/<room>/state/bin" instead of the JSON
+ * body on "suction/<room>/state".
+ *
+ * Version 1 layout, 16 bytes, integers little-endian:
+ *
+ *   offset size field
+ *        0    1 magic      'S' (0x53)
+ *        1    1 version    1
+ *        2    1 flags      bit 0 suction on, bit 1 motion; others reserved (0)
+ *        3    1 reserved   0
+ *        4    4 seq        per-device counter, wraps
+ *        8    8 device_ms  device clock in milliseconds (millis() or Unix ms)
+ *
+ * Later versions may append fields; a decoder accepts any payload of at
+ * least SUCTION_STATE_SIZE bytes whose version it knows.
+ *
+ * Firmware: copy this file next to the sketch.
+ */
+#ifndef SUCTION_STATE_CODEC_H
+#define SUCTION_STATE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SUCTION_STATE_MAGIC      0x53u
+#define SUCTION_STATE_VERSION    1u
+#define SUCTION_STATE_SIZE       16u
+
+#define SUCTION_STATE_FLAG_ON     0x01u
+#define SUCTION_STATE_FLAG_MOTION 0x02u
+
+typedef struct {
+    uint8_t  flags;     /* SUCTION_STATE_FLAG_* */
+    uint32_t seq;
+    uint64_t device_ms;
+} suction_state_t;
+
+enum {
+    SUCTION_STATE_OK          = 0,
+    SUCTION_STATE_ERR_SIZE    = -1,
+    SUCTION_STATE_ERR_MAGIC   = -2,
+    SUCTION_STATE_ERR_VERSION = -3,
+};
+
+static inline void suction_state_encode(const suction_state_t* s, uint8_t out[SUCTION_STATE_SIZE]) {
+    out[0] = (uint8_t)SUCTION_STATE_MAGIC;
+    out[1] = (uint8_t)SUCTION_STATE_VERSION;
+    out[2] = s->flags;
+    out[3] = 0;
+    for (int i = 0; i < 4; ++i) out[4 + i] = (uint8_t)(s->seq >> (8 * i));
+    for (int i = 0; i < 8; ++i) out[8 + i] = (uint8_t)(s->device_ms >> (8 * i));
+}
+
+/* Returns SUCTION_STATE_OK or a negative SUCTION_STATE_ERR_*. */
+static inline int suction_state_decode(const uint8_t* in, size_t len, suction_state_t* out) {
+    if (len < SUCTION_STATE_SIZE) return SUCTION_STATE_ERR_SIZE;
+    if (in[0] != SUCTION_STATE_MAGIC) return SUCTION_STATE_ERR_MAGIC;
+    if (in[1] != SUCTION_STATE_VERSION) return SUCTION_STATE_ERR_VERSION;
+    out->flags = in[2];
+    out->seq = 0;
+    for (int i = 3; i >= 0; --i) out->seq = (out->seq << 8) | in[4 + i];
+    out->device_ms = 0;
+    for (int i = 7; i >= 0; --i) out->device_ms = (out->device_ms << 8) | in[8 + i];
+    return SUCTION_STATE_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SUCTION_STATE_CODEC_H */
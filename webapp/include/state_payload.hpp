@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// "suction/<room>/state" → "<room>", as a view into `topic`; empty if the
+// topic has fewer than two '/'.
+std::string_view room_from_topic(std::string_view topic);
+
+// Longest room name (bytes) the ingestor queues inline; longer ones are
+// rejected. With its length and kind byte it fills one 64-byte line.
+inline constexpr std::size_t kMaxRoomName = 62;
+
+// The fixed body published on suction/<room>/state:
+//   {"suction_on":true|false,"motion":true|false,"seq":<u32>,"ts":<u64 ms>}
+// seq counts up per device (0 after boot); ts is the device clock.
+struct StatePayload {
+    bool suction_on = false;
+    bool motion = false;
+    bool has_motion = false;
+    bool has_seq = false;
+    bool has_ts = false;
+    std::uint32_t seq = 0;
+    std::uint64_t ts = 0;
+};
+
+// Allocation-free parser for exactly that shape: an object holding
+// "suction_on" (required) and "motion" as JSON booleans and "seq", "ts" as
+// unsigned integers (all optional), in any order, with optional whitespace.
+// Anything else returns false and should go to a general JSON parser.
+bool parse_state_payload(std::string_view in, StatePayload& out);
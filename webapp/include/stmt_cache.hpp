@@ -0,0 +1,86 @@
+#pragma once
+#include <sqlite3.h>
+#include <array>
+#include <cstddef>
+#include <chrono>
+#include <utility>
+#include "metrics.hpp"
+
+// Every statement Repo runs. The SQL text lives in stmt_cache.cpp.
+enum class Stmt {
+    CountRooms,
+    RoomIdByNumber,
+    InsertRoom,
+    RoomStates,
+    RoomStateById,
+    InsertSchedule,
+    SuctionState,
+    InsertSuctionLog,
+    UpsertSuctionState,
+    RoomIds,
+    RollupState,
+    FirstLogTimestamp,
+    LogRange,
+    UpsertHourly,
+    UpsertRollupState,
+    HourlyRange,
+    PruneSuctionLog,
+    LogPage,
+    Begin,
+    Commit,
+    Rollback,
+    Count_
+};
+
+// Name of a statement, as in the enum ("RoomStates").
+const char* stmt_name(Stmt id);
+
+// Prepared statements for one connection.
+// Each statement is compiled on first use and reused until the cache dies.
+// Not thread-safe: guard it with whatever guards the connection.
+// How long each statement is held (binds, steps and reads, up to its reset)
+// is recorded per statement in suction_sqlite_statement_duration_seconds.
+class StmtCache {
+public:
+    // Borrowed statement; reset and unbound again when the handle goes away.
+    class Handle {
+    public:
+        Handle(sqlite3_stmt* s, Histogram* timer)
+            : s_(s), timer_(s ? timer : nullptr),
+              start_(timer_ ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{}) {}
+        Handle(Handle&& o) noexcept
+            : s_(std::exchange(o.s_, nullptr)), timer_(std::exchange(o.timer_, nullptr)), start_(o.start_) {}
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+        Handle& operator=(Handle&&) = delete;
+        ~Handle() {
+            if (s_) {
+                sqlite3_reset(s_);
+                sqlite3_clear_bindings(s_);
+            }
+            if (timer_) timer_->observe(std::chrono::steady_clock::now() - start_);
+        }
+
+        operator sqlite3_stmt*() const { return s_; }
+        explicit operator bool() const { return s_ != nullptr; }
+
+    private:
+        sqlite3_stmt* s_;
+        Histogram* timer_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    explicit StmtCache(sqlite3* db);
+    ~StmtCache();
+
+    StmtCache(const StmtCache&) = delete;
+    StmtCache& operator=(const StmtCache&) = delete;
+
+    // Null handle if the statement fails to compile.
+    Handle get(Stmt id);
+
+private:
+    sqlite3* db_;
+    std::array<sqlite3_stmt*, static_cast<std::size_t>(Stmt::Count_)> stmts_{};
+    std::array<Histogram*, static_cast<std::size_t>(Stmt::Count_)> timers_{};
+};
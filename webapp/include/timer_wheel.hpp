@@ -0,0 +1,62 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Hashed timing wheel over integer keys. Time is in whole ticks; an entry
+// due at tick t sits in bucket t % slots, so moving time forward one tick
+// only looks at one bucket, no matter how many entries there are.
+// Entries due more than `slots` ticks out simply stay in their bucket until
+// a later lap. Not thread-safe; callers serialize.
+class TimerWheel {
+public:
+    explicit TimerWheel(std::size_t slots) : buckets_(slots ? slots : 1) {}
+
+    std::uint64_t now() const { return now_; }
+    std::size_t size() const { return size_; }
+
+    // Fires `key` once time reaches `due` (anything not in the future fires
+    // on the next advance).
+    void schedule(int key, std::uint64_t due) {
+        if (due <= now_) due = now_ + 1;
+        buckets_[due % buckets_.size()].push_back({key, due});
+        ++size_;
+    }
+
+    // Moves time forward to `to`, calling on_expire(key) for every entry that
+    // is due by then. on_expire may schedule() again.
+    template <class F>
+    void advance(std::uint64_t to, F&& on_expire) {
+        if (to <= now_) return;
+        // After a long gap every bucket is visited once rather than once per tick.
+        const std::uint64_t steps = std::min<std::uint64_t>(to - now_, buckets_.size());
+        const std::uint64_t first = now_ + 1;
+        now_ = to;
+        for (std::uint64_t i = 0; i < steps; ++i) {
+            auto& bucket = buckets_[(first + i) % buckets_.size()];
+            if (bucket.empty()) continue;
+            std::vector<Entry> due;
+            std::swap(due, bucket);
+            for (const auto& e : due) {
+                if (e.due <= to) {
+                    --size_;
+                    on_expire(e.key);
+                } else {
+                    bucket.push_back(e); // a later lap
+                }
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        int key;
+        std::uint64_t due;
+    };
+
+    std::vector<std::vector<Entry>> buckets_;
+    std::uint64_t now_ = 0;
+    std::size_t size_ = 0;
+};
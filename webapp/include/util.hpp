@@ -1,4 +1,24 @@
 #pragma once
+#include <cstdint>
+#include <ctime>
 #include <string>
 
-std::string format_timestamp();
\ No newline at end of file
+std::string format_timestamp();
+
+// Broken-down local time for "now".
+std::tm local_now();
+// Broken-down local time for a Unix time.
+std::tm local_time(std::int64_t unix_seconds);
+
+// Unix seconds for "now".
+std::int64_t epoch_seconds();
+
+// Local date as the integer YYYYMMDD (how room_schedule.date is stored).
+int date_key(const std::tm& tm);
+
+// YYYYMMDD shifted by a number of calendar days.
+int add_days(int key, int days);
+
+// "HH:MM" <-> minutes since midnight; parse_hhmm returns -1 if malformed.
+int parse_hhmm(const std::string& hhmm);
+std::string format_minutes(int minutes);
@@ -1,6 +1,27 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
+#include "compress.hpp"
 #include "models.hpp"
 
+// The dashboard page. Everything but the cards and the timestamp is
+// assembled once, on first use; CSS and JS are linked as static assets.
 std::string render_dashboard(const std::vector<OperatingRoom>& rooms);
+
+// A file the dashboard links to, compressed once when first needed. Its
+// path carries a hash of the content, so clients may cache it for good.
+struct StaticAsset {
+    std::string path;          // "/assets/dashboard.<hash>.css"
+    std::string content_type;
+    std::string etag;
+    std::string body;
+    std::string gzip;          // empty if not smaller than body
+    std::string brotli;        // likewise, or built without brotli
+
+    // The body in `e`, falling back to identity (and setting `e` to say so).
+    const std::string& encoded(Encoding& e) const;
+};
+
+// The asset served at `path`, or nullptr.
+const StaticAsset* find_asset(std::string_view path);
@@ -1,29 +1,89 @@
 #include "api.hpp"
+#include "metrics.hpp"
+#include "room_json.hpp"
+#include "rooms_cache.hpp"
 #include "views.hpp"
 #include "util.hpp"
 #include <crow.h>
+#include <nlohmann/json.hpp>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
 
-static crow::json::wvalue rooms_to_json(const std::vector<OperatingRoom>& rooms) {
-    crow::json::wvalue::list list;
-    list.reserve(rooms.size());
-    for (const auto& room : rooms) {
-        crow::json::wvalue item;
-        item["id"]         = room.id;
-        item["roomNumber"] = room.room_number;
-        item["procedure"]  = room.procedure;
-        item["schedule"]   = room.schedule;
-        item["suctionOn"]  = room.suction_on;
-        list.push_back(std::move(item));
+static crow::json::wvalue ingest_stats_to_json(const IngestStats& s) {
+    crow::json::wvalue res;
+    res["depth"]       = s.depth;
+    res["capacity"]    = s.capacity;
+    res["highWater"]   = s.high_water;
+    res["received"]    = s.received;
+    res["dropped"]     = s.dropped;
+    res["processed"]   = s.processed;
+    res["coalesced"]   = s.coalesced;
+    res["duplicates"]  = s.duplicates;
+    res["applied"]     = s.applied;
+    res["writesSaved"] = s.coalesced + s.duplicates;
+    res["seqGaps"]     = s.seq_gaps;
+    res["outOfOrder"]  = s.out_of_order;
+    res["seqResets"]   = s.seq_resets;
+    return res;
+}
+
+// Percentiles in microseconds.
+static crow::json::wvalue histogram_to_json(const LatencyHistogram& h) {
+    crow::json::wvalue res;
+    res["count"] = h.count();
+    res["mean"]  = h.mean();
+    res["p50"]   = h.percentile(0.50);
+    res["p90"]   = h.percentile(0.90);
+    res["p99"]   = h.percentile(0.99);
+    res["p999"]  = h.percentile(0.999);
+    res["max"]   = h.max();
+    return res;
+}
+
+// Parses a whole query value as an integer; false if it is not one.
+static bool parse_int64(const char* v, std::int64_t& out) {
+    const char* end = v + std::strlen(v);
+    auto [p, ec] = std::from_chars(v, end, out);
+    return ec == std::errc() && p == end && p != v;
+}
+
+static const char* suction_status_name(SuctionUpdateStatus s) {
+    switch (s) {
+        case SuctionUpdateStatus::Applied:     return "applied";
+        case SuctionUpdateStatus::UnknownRoom: return "unknown_room";
+        case SuctionUpdateStatus::RolledUp:    return "rolled_up";
+        case SuctionUpdateStatus::OutOfOrder:  return "out_of_order";
+        case SuctionUpdateStatus::InFuture:    return "in_future";
+        case SuctionUpdateStatus::Failed:      return "failed";
     }
-    crow::json::wvalue payload;
-    payload["rooms"] = std::move(list);
-    payload["generatedAt"] = format_timestamp();
-    return payload;
+    return "failed";
 }
 
-void register_routes(crow::SimpleApp& app, Repo& repo) {
+// Handler time for one route, labelled with its pattern rather than the URL
+// so ids do not multiply the series.
+static Histogram& route_timer(const char* route) {
+    return metrics().histogram("suction_http_request_duration_seconds",
+                               "Time spent in the route handler.", {{"route", route}});
+}
+
+// History cursors are "<timestamp>-<id>" of the last event on the previous page.
+static bool parse_cursor(const char* v, std::int64_t& ts, std::int64_t& id) {
+    const char* dash = std::strchr(v, '-');
+    if (!dash || dash == v) return false;
+    const char* end = v + std::strlen(v);
+    auto [p1, ec1] = std::from_chars(v, dash, ts);
+    auto [p2, ec2] = std::from_chars(dash + 1, end, id);
+    return ec1 == std::errc() && p1 == dash && ec2 == std::errc() && p2 == end && p2 != dash + 1;
+}
+
+void register_routes(crow::SimpleApp& app, Repo& repo, const MqttIngestor& ingestor,
+                     RoomBroadcaster& broadcaster) {
     // HTML dashboard
-    CROW_ROUTE(app, "/")([&repo]{
+    CROW_ROUTE(app, "/")([&repo, &timer = route_timer("/")]{
+        const ScopedTimer timed(timer);
         auto rooms = repo.load_rooms();
         crow::response res;
         res.code = crow::status::OK;
@@ -32,18 +92,108 @@ void register_routes(crow::SimpleApp& app, Repo& repo) {
         return res;
     });
 
+    // Dashboard CSS/JS. The name carries a content hash, so a given URL never
+    // changes and clients may keep it for a year.
+    CROW_ROUTE(app, "/assets/<string>")([&timer = route_timer("/assets/<string>")](const crow::request& req, const std::string& name){
+        const ScopedTimer timed(timer);
+        const StaticAsset* asset = find_asset("/assets/" + name);
+        if (!asset) return crow::response(crow::status::NOT_FOUND);
+
+        crow::response res;
+        res.set_header("Cache-Control", "public, max-age=31536000, immutable");
+        res.set_header("Vary", "Accept-Encoding");
+        res.set_header("ETag", asset->etag);
+        if (req.get_header_value("If-None-Match") == asset->etag) {
+            res.code = crow::status::NOT_MODIFIED;
+            return res;
+        }
+        Encoding enc = negotiate_encoding(req.get_header_value("Accept-Encoding"));
+        res.body = asset->encoded(enc);
+        if (enc != Encoding::Identity) res.set_header("Content-Encoding", encoding_name(enc));
+        res.set_header("Content-Type", asset->content_type);
+        return res;
+    });
+
     // JSON API for current room data
-    CROW_ROUTE(app, "/api/rooms")([&repo]{
-        auto rooms = repo.load_rooms();
-        auto json = rooms_to_json(rooms);
-        crow::response res{json};
+    // Served from RoomsResponseCache: one serialization (and one gzip/br
+    // compression) per state version and minute, shared by every request.
+    // Unchanged since the client's copy (same ETag) → empty 304.
+    auto rooms_cache = std::make_shared<RoomsResponseCache>(repo);
+    CROW_ROUTE(app, "/api/rooms")([rooms_cache, &timer = route_timer("/api/rooms")](const crow::request& req){
+        const ScopedTimer timed(timer);
+        crow::response res;
+        res.set_header("Cache-Control", "no-cache");
+        res.set_header("Vary", "Accept-Encoding");
+
+        const std::string etag = rooms_cache->current_etag();
+        if (req.get_header_value("If-None-Match") == etag) {
+            res.code = crow::status::NOT_MODIFIED;
+            res.set_header("ETag", etag);
+            return res;
+        }
+        const auto body = rooms_cache->get();
+        Encoding enc = negotiate_encoding(req.get_header_value("Accept-Encoding"));
+        res.body = body->encoded(enc); // Crow owns bodies as strings: a copy, not a re-serialization
+        if (enc != Encoding::Identity) res.set_header("Content-Encoding", encoding_name(enc));
+        res.set_header("Content-Type", "application/json");
+        res.set_header("ETag", body->etag());
+        return res;
+    });
+
+    // Rooms changed since the caller's copy: ?since=<version>&minute=<minute>,
+    // both from the previous answer. Every room ("full": true) when the
+    // change journal no longer reaches back to `since`; since=0 always does.
+    CROW_ROUTE(app, "/api/rooms/changes")([&repo, &timer = route_timer("/api/rooms/changes")](const crow::request& req){
+        const ScopedTimer timed(timer);
+        std::int64_t since = 0, minute = 0, epoch = 0;
+        const char* since_v = req.url_params.get("since");
+        const char* minute_v = req.url_params.get("minute");
+        const char* epoch_v = req.url_params.get("epoch");
+        if (!since_v || !parse_int64(since_v, since) || since < 0) {
+            return crow::response(crow::status::BAD_REQUEST, std::string("since must be a state version"));
+        }
+        if (epoch_v && (!parse_int64(epoch_v, epoch) || epoch < 0 || epoch > 0xFFFFFFFFLL)) {
+            return crow::response(crow::status::BAD_REQUEST, std::string("epoch must be a previous answer's epoch"));
+        }
+        if (minute_v && (!parse_int64(minute_v, minute) || minute < 0)) {
+            return crow::response(crow::status::BAD_REQUEST, std::string("minute must be Unix minutes"));
+        }
+
+        const RoomChanges changes = repo.changes_since(static_cast<std::uint32_t>(epoch),
+                                                       static_cast<std::uint64_t>(since), minute);
+        crow::json::wvalue payload = rooms_to_json(changes.rooms);
+        payload["epoch"]   = changes.epoch;
+        payload["version"] = changes.version;
+        payload["minute"]  = changes.minute;
+        payload["full"]    = changes.full;
+        crow::response res{payload};
         res.set_header("Cache-Control", "no-store");
         return res;
     });
 
+    // Push stream for the dashboard: the full room list, then deltas
+    // (see RoomBroadcaster). Clients only listen; anything they send is ignored.
+    //
+    // The broadcaster calls send_text() from its own thread. That is how
+    // Crow's websocket example broadcasts too: send_text() only frames the
+    // message and dispatches the write onto the connection's io_service, so
+    // the socket and the write queue are only ever touched on the
+    // connection's io thread. Crow deletes the connection after onclose
+    // returns, and unsubscribe() waits out a send in progress, so no
+    // send_text() reaches a connection that is being torn down.
+    CROW_WEBSOCKET_ROUTE(app, "/api/rooms/stream")
+        .onopen([&broadcaster](crow::websocket::connection& conn) {
+            broadcaster.subscribe(&conn, [&conn](const std::string& msg) { conn.send_text(msg); });
+        })
+        .onclose([&broadcaster](crow::websocket::connection& conn, const std::string& /*reason*/) {
+            broadcaster.unsubscribe(&conn);
+        })
+        .onmessage([](crow::websocket::connection& /*conn*/, const std::string& /*data*/, bool /*is_binary*/) {});
+
     // Update suction status (log event)
     CROW_ROUTE(app, "/api/rooms/<int>/suction/<int>")
-    ([&repo](int id, int status){
+    ([&repo, &timer = route_timer("/api/rooms/<int>/suction/<int>")](int id, int status){
+        const ScopedTimer timed(timer);
         bool suction_on = (status != 0);
         repo.update_suction(id, suction_on);
         crow::json::wvalue res;
@@ -54,6 +204,217 @@ void register_routes(crow::SimpleApp& app, Repo& repo) {
         return res;
     });
 
+    // Many suction updates at once (gateways, backfills): a JSON array of
+    // {"roomId"|"roomNumber", "suctionOn", "ts" (Unix seconds, default now)},
+    // applied in one transaction. "results" has one entry per item, in order.
+    CROW_ROUTE(app, "/api/suction/batch").methods(crow::HTTPMethod::Post)
+    ([&repo, &timer = route_timer("/api/suction/batch")](const crow::request& req){
+        const ScopedTimer timed(timer);
+        constexpr std::size_t kMaxItems = 10000;
+        nlohmann::json items;
+        try {
+            items = nlohmann::json::parse(req.body);
+        } catch (const std::exception& e) {
+            return crow::response(crow::status::BAD_REQUEST, std::string("body is not JSON: ") + e.what());
+        }
+        if (!items.is_array() || items.size() > kMaxItems) {
+            return crow::response(crow::status::BAD_REQUEST, std::string("body must be an array of at most 10000 updates"));
+        }
+
+        // Malformed items are answered here; the rest go to the Repo together.
+        const std::int64_t now = epoch_seconds();
+        std::vector<const char*> invalid(items.size(), nullptr);
+        std::vector<SuctionUpdate> updates;
+        std::vector<std::size_t> index; // updates[k] is items[index[k]]
+        updates.reserve(items.size());
+        index.reserve(items.size());
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            const auto& item = items[i];
+            SuctionUpdate u;
+            const auto on = item.is_object() ? item.find("suctionOn") : item.end();
+            const auto ts = item.is_object() ? item.find("ts") : item.end();
+            if (!item.is_object() || on == item.end() || !on->is_boolean()) {
+                invalid[i] = "suctionOn must be true or false";
+                continue;
+            }
+            if (ts != item.end() && !ts->is_number_integer()) {
+                invalid[i] = "ts must be Unix seconds";
+                continue;
+            }
+            if (auto id = item.find("roomId"); id != item.end()) {
+                if (!id->is_number_integer()) {
+                    invalid[i] = "roomId must be an integer";
+                    continue;
+                }
+                const auto v = id->get<std::int64_t>();
+                if (v < 1 || v > std::numeric_limits<int>::max()) {
+                    invalid[i] = "roomId out of range";
+                    continue;
+                }
+                u.room_id = static_cast<int>(v);
+            } else if (auto number = item.find("roomNumber"); number != item.end() && number->is_string()
+                       && !number->get_ref<const std::string&>().empty()) {
+                // Only rooms that exist; new ones come from MQTT ingest. 0 is
+                // answered as unknown_room.
+                u.room_id = repo.find_room_id(number->get_ref<const std::string&>());
+            } else {
+                invalid[i] = "roomId or roomNumber required";
+                continue;
+            }
+            u.suction_on = on->get<bool>();
+            u.timestamp = ts != item.end() ? ts->get<std::int64_t>() : now;
+            updates.push_back(u);
+            index.push_back(i);
+        }
+
+        const auto status = repo.update_suction_batch(updates);
+
+        crow::json::wvalue::list results(items.size());
+        std::size_t applied = 0;
+        bool failed = false;
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            if (invalid[i]) {
+                results[i]["status"] = "invalid";
+                results[i]["error"] = invalid[i];
+            }
+        }
+        for (std::size_t k = 0; k < updates.size(); ++k) {
+            auto& r = results[index[k]];
+            if (updates[k].room_id > 0) r["roomId"] = updates[k].room_id;
+            r["status"] = suction_status_name(status[k]);
+            applied += status[k] == SuctionUpdateStatus::Applied;
+            failed = failed || status[k] == SuctionUpdateStatus::Failed;
+        }
+        crow::json::wvalue payload;
+        payload["applied"] = applied;
+        payload["results"] = std::move(results);
+        return crow::response(failed ? crow::status::INTERNAL_SERVER_ERROR : crow::status::OK, payload);
+    });
+
+    // Hourly suction usage for one room: ?from=&to= (Unix seconds, default last 24h)
+    CROW_ROUTE(app, "/api/rooms/<int>/usage")
+    ([&repo, &timer = route_timer("/api/rooms/<int>/usage")](const crow::request& req, int id){
+        const ScopedTimer timed(timer);
+        std::int64_t to = epoch_seconds();
+        std::int64_t from = to - 24 * 3600;
+        const char* to_v = req.url_params.get("to");
+        const char* from_v = req.url_params.get("from");
+        if ((to_v && !parse_int64(to_v, to)) || (from_v && !parse_int64(from_v, from))) {
+            return crow::response(crow::status::BAD_REQUEST, std::string("from/to must be Unix seconds"));
+        }
+        if (from >= to) {
+            return crow::response(crow::status::BAD_REQUEST, std::string("from must be before to"));
+        }
+
+        crow::json::wvalue::list hours;
+        for (const auto& h : repo.hourly_usage(id, from, to)) {
+            crow::json::wvalue item;
+            item["hour"]        = h.hour;
+            item["onSeconds"]   = h.on_seconds;
+            item["transitions"] = h.transitions;
+            hours.push_back(std::move(item));
+        }
+        crow::json::wvalue payload;
+        payload["roomId"] = id;
+        payload["hours"]  = std::move(hours);
+        return crow::response{payload};
+    });
+
+    // Suction transitions for one room, oldest first:
+    // ?from=&to= (Unix seconds), ?limit= (1-1000, default 100), ?after=<nextCursor>
+    CROW_ROUTE(app, "/api/rooms/<int>/history")
+    ([&repo, &timer = route_timer("/api/rooms/<int>/history")](const crow::request& req, int id){
+        const ScopedTimer timed(timer);
+        std::int64_t from = 0;
+        std::int64_t to = std::numeric_limits<std::int64_t>::max();
+        std::int64_t limit = 100;
+        std::int64_t after_ts = 0, after_id = 0;
+        const char* from_v = req.url_params.get("from");
+        const char* to_v = req.url_params.get("to");
+        const char* limit_v = req.url_params.get("limit");
+        const char* after_v = req.url_params.get("after");
+        if ((from_v && !parse_int64(from_v, from)) || (to_v && !parse_int64(to_v, to))) {
+            return crow::response(crow::status::BAD_REQUEST, std::string("from/to must be Unix seconds"));
+        }
+        if (limit_v && (!parse_int64(limit_v, limit) || limit < 1 || limit > 1000)) {
+            return crow::response(crow::status::BAD_REQUEST, std::string("limit must be 1-1000"));
+        }
+        if (after_v && !parse_cursor(after_v, after_ts, after_id)) {
+            return crow::response(crow::status::BAD_REQUEST, std::string("bad after cursor"));
+        }
+
+        // One extra row tells us whether there is another page.
+        auto events = repo.suction_history(id, from, to, after_ts, after_id, static_cast<int>(limit) + 1);
+        const bool more = events.size() > static_cast<std::size_t>(limit);
+        if (more) events.pop_back();
+
+        crow::json::wvalue::list list;
+        list.reserve(events.size());
+        for (const auto& e : events) {
+            crow::json::wvalue item;
+            item["id"]        = e.id;
+            item["suctionOn"] = e.suction_on;
+            item["timestamp"] = e.timestamp;
+            list.push_back(std::move(item));
+        }
+        crow::json::wvalue payload;
+        payload["roomId"] = id;
+        payload["events"] = std::move(list);
+        if (more) {
+            payload["nextCursor"] = std::to_string(events.back().timestamp) + "-" + std::to_string(events.back().id);
+        } else {
+            payload["nextCursor"] = nullptr;
+        }
+        return crow::response{payload};
+    });
+
+    // MQTT ingest queue counters, totalled and per worker
+    CROW_ROUTE(app, "/api/ingest/stats")([&ingestor, &timer = route_timer("/api/ingest/stats")]{
+        const ScopedTimer timed(timer);
+        crow::json::wvalue res = ingest_stats_to_json(ingestor.stats());
+        crow::json::wvalue::list workers;
+        for (const auto& w : ingestor.worker_stats()) {
+            crow::json::wvalue item = ingest_stats_to_json(w.ingest);
+            item["clientId"]  = w.client_id;
+            item["connected"] = w.connected;
+            workers.push_back(std::move(item));
+        }
+        res["workers"] = std::move(workers);
+        const IngestLatency& lat = ingestor.latency();
+        crow::json::wvalue latency;
+        latency["device"]    = histogram_to_json(lat.device);
+        latency["parsed"]    = histogram_to_json(lat.parsed);
+        latency["visible"]   = histogram_to_json(lat.visible);
+        latency["committed"] = histogram_to_json(lat.committed);
+        res["latencyUs"] = std::move(latency);
+        crow::response r{res};
+        r.set_header("Cache-Control", "no-store");
+        return r;
+    });
+
     // Health check
-    CROW_ROUTE(app, "/health")([]{ return "ok"; });
+    CROW_ROUTE(app, "/health")([&timer = route_timer("/health")]{
+        const ScopedTimer timed(timer);
+        return "ok";
+    });
+
+    // Prometheus scrape: everything in metrics(), plus a few values read now.
+    CROW_ROUTE(app, "/metrics")([&repo, &ingestor, &broadcaster, &timer = route_timer("/metrics")]{
+        const ScopedTimer timed(timer);
+        std::string body = metrics().render();
+        write_gauge(body, "suction_state_version", "Repo state version (bumped on every room change).",
+                    static_cast<double>(repo.state_version()));
+        write_gauge(body, "suction_stream_subscribers", "Open /api/rooms/stream connections.",
+                    static_cast<double>(broadcaster.subscribers()));
+        write_gauge(body, "suction_ingest_queue_depth", "MQTT updates queued for the Repo, all workers.",
+                    static_cast<double>(ingestor.stats().depth));
+        const IngestLatency& lat = ingestor.latency();
+        write_latency_histograms(body, "suction_ingest_latency_seconds",
+                                 "MQTT ingest latency per stage (see /api/ingest/stats).", "stage",
+                                 {{"device", &lat.device}, {"parsed", &lat.parsed},
+                                  {"visible", &lat.visible}, {"committed", &lat.committed}});
+        crow::response res{std::move(body)};
+        res.set_header("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+        return res;
+    });
 }
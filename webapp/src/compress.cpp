@@ -0,0 +1,85 @@
+#include "compress.hpp"
+#include <zlib.h>
+#ifdef SUCTION_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+#include <cstdint>
+#include <cstdlib>
+
+const char* encoding_name(Encoding e) {
+    switch (e) {
+        case Encoding::Gzip:   return "gzip";
+        case Encoding::Brotli: return "br";
+        default:               return "";
+    }
+}
+
+Encoding negotiate_encoding(std::string_view accept) {
+    // A named coding's own entry decides for it; "*" only speaks for the
+    // codings the header does not name.
+    bool gzip = false, br = false, any = false;
+    bool gzip_named = false, br_named = false;
+    while (!accept.empty()) {
+        std::string_view item = accept.substr(0, accept.find(','));
+        accept.remove_prefix(item.size() < accept.size() ? item.size() + 1 : accept.size());
+
+        // "coding;q=0.5" → coding, and whether q is zero
+        std::string_view coding = item.substr(0, item.find(';'));
+        bool refused = false;
+        if (auto q = item.find("q="); q != std::string_view::npos) {
+            refused = std::strtod(std::string(item.substr(q + 2)).c_str(), nullptr) <= 0.0;
+        }
+        while (!coding.empty() && (coding.front() == ' ' || coding.front() == '\t')) coding.remove_prefix(1);
+        while (!coding.empty() && (coding.back() == ' ' || coding.back() == '\t')) coding.remove_suffix(1);
+        if (coding == "gzip") {
+            gzip_named = true;
+            gzip = !refused;
+        } else if (coding == "br") {
+            br_named = true;
+            br = !refused;
+        } else if (coding == "*") {
+            any = !refused;
+        }
+    }
+    if (!gzip_named) gzip = any;
+    if (!br_named) br = any;
+#ifdef SUCTION_HAVE_BROTLI
+    if (br) return Encoding::Brotli;
+#else
+    (void)br;
+#endif
+    return gzip ? Encoding::Gzip : Encoding::Identity;
+}
+
+std::string gzip_compress(std::string_view data, int level) {
+    z_stream zs{};
+    // 15 window bits + 16 = gzip header and trailer instead of zlib's
+    if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return {};
+    std::string out(deflateBound(&zs, static_cast<uLong>(data.size())), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+    const int rc = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return rc == Z_STREAM_END ? out : std::string();
+}
+
+std::string brotli_compress(std::string_view data, int quality) {
+#ifdef SUCTION_HAVE_BROTLI
+    std::string out(BrotliEncoderMaxCompressedSize(data.size()), '\0');
+    std::size_t size = out.size();
+    if (!BrotliEncoderCompress(quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                               data.size(), reinterpret_cast<const std::uint8_t*>(data.data()),
+                               &size, reinterpret_cast<std::uint8_t*>(out.data()))) {
+        return {};
+    }
+    out.resize(size);
+    return out;
+#else
+    (void)data;
+    (void)quality;
+    return {};
+#endif
+}
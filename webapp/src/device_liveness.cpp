@@ -0,0 +1,87 @@
+// src/device_liveness.cpp
+#include "device_liveness.hpp"
+#include <utility>
+#include "repo.hpp"
+
+DeviceLiveness::DeviceLiveness(Repo& repo, LivenessOptions opts)
+    : repo_(repo),
+      opts_(opts),
+      stale_ticks_(static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(opts.stale_after) / opts.tick)),
+      origin_(std::chrono::steady_clock::now()),
+      wheel_(opts.wheel_slots) {
+    if (stale_ticks_ == 0) stale_ticks_ = 1;
+}
+
+DeviceLiveness::~DeviceLiveness() {
+    stop();
+}
+
+void DeviceLiveness::start() {
+    if (thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lk(thread_mtx_);
+        stop_ = false;
+    }
+    thread_ = std::thread([this]{ loop(); });
+}
+
+void DeviceLiveness::stop() {
+    {
+        std::lock_guard<std::mutex> lk(thread_mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+std::uint64_t DeviceLiveness::current_tick() const {
+    return static_cast<std::uint64_t>((std::chrono::steady_clock::now() - origin_) / opts_.tick);
+}
+
+// Repo::set_room_stale() is called with mtx_ held so flag changes reach the
+// snapshot in the order they were decided here (mtx_ is taken before any
+// Repo lock, never after).
+void DeviceLiveness::seen(int room_id) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    Device& d = devices_[room_id];
+    d.last_seen = current_tick();
+    if (!d.armed) {
+        wheel_.schedule(room_id, d.last_seen + stale_ticks_);
+        d.armed = true;
+    }
+    if (std::exchange(d.stale, false)) repo_.set_room_stale(room_id, false);
+}
+
+void DeviceLiveness::offline(int room_id) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    Device& d = devices_[room_id];
+    // An armed timer finds the room already stale and disarms itself.
+    if (!std::exchange(d.stale, true)) repo_.set_room_stale(room_id, true);
+}
+
+void DeviceLiveness::tick() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    const std::uint64_t now = current_tick();
+    wheel_.advance(now, [&](int room_id) {
+        Device& d = devices_[room_id];
+        const std::uint64_t deadline = d.last_seen + stale_ticks_;
+        if (!d.stale && deadline > now) {
+            wheel_.schedule(room_id, deadline); // heard from since; re-arm
+            return;
+        }
+        d.armed = false;
+        if (!std::exchange(d.stale, true)) repo_.set_room_stale(room_id, true);
+    });
+}
+
+void DeviceLiveness::loop() {
+    std::unique_lock<std::mutex> lk(thread_mtx_);
+    while (!stop_) {
+        cv_.wait_for(lk, opts_.tick, [this]{ return stop_; });
+        if (stop_) break;
+        lk.unlock();
+        tick();
+        lk.lock();
+    }
+}
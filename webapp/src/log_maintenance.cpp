@@ -0,0 +1,53 @@
+// src/log_maintenance.cpp
+#include "log_maintenance.hpp"
+#include <crow.h>
+#include "repo.hpp"
+#include "util.hpp"
+
+LogMaintenance::LogMaintenance(Repo& repo, MaintenanceOptions opts)
+    : repo_(repo), opts_(opts) {}
+
+LogMaintenance::~LogMaintenance() {
+    stop();
+}
+
+void LogMaintenance::start() {
+    if (thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = false;
+    }
+    thread_ = std::thread([this]{ loop(); });
+}
+
+void LogMaintenance::stop() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void LogMaintenance::run_once() {
+    const std::int64_t now = epoch_seconds();
+    const auto retention = std::chrono::duration_cast<std::chrono::seconds>(opts_.retention).count();
+
+    // Roll up first: pruning only ever removes rows behind the rollup watermark.
+    int rooms = repo_.rollup_hourly(now);
+    std::size_t pruned = repo_.prune_suction_log(now - retention, opts_.delete_batch);
+    if (rooms > 0 || pruned > 0) {
+        CROW_LOG_INFO << "Log maintenance: rolled up " << rooms << " room(s), pruned "
+                      << pruned << " suction_log row(s)";
+    }
+}
+
+void LogMaintenance::loop() {
+    std::unique_lock<std::mutex> lk(mtx_);
+    while (!stop_) {
+        lk.unlock();
+        run_once();
+        lk.lock();
+        cv_.wait_for(lk, opts_.interval, [this]{ return stop_; });
+    }
+}
@@ -2,6 +2,8 @@
 #include "repo.hpp"
 #include "api.hpp"
 #include "mqtt_ingestor.hpp"
+#include "log_maintenance.hpp"
+#include "room_broadcaster.hpp"
 #include <iostream>
 #include <cstdlib>
 
@@ -12,15 +14,34 @@ int main() {
     repo.seed_if_empty(); //init DB
 
     //Mqtt subscriber
-    MqttIngestor ingestor(repo, "localhost", 1883, "suction/+/state", 1);
+    IngestOptions ingest;
+    if (const char* w = std::getenv("SUCTION_INGEST_WORKERS")) {
+        try { ingest.workers = static_cast<std::size_t>(std::stoul(w)); }
+        catch (...) { std::cerr << "[WARN] Bad SUCTION_INGEST_WORKERS='" << w << "'; using 1\n"; }
+    }
+    if (const char* g = std::getenv("SUCTION_INGEST_GROUP")) ingest.share_group = g;
+    MqttIngestor ingestor(repo, "localhost", 1883, "suction/+/state", 1, ingest);
     if (!ingestor.start()) {
         CROW_LOG_ERROR << "MQTT ingestor failed to start";
     }
 
+    //Hourly rollups + suction_log retention
+    MaintenanceOptions maintenance;
+    if (const char* d = std::getenv("SUCTION_LOG_RETENTION_DAYS")) {
+        try { maintenance.retention = std::chrono::hours(24 * std::stoi(d)); }
+        catch (...) { std::cerr << "[WARN] Bad SUCTION_LOG_RETENTION_DAYS='" << d << "'; using 30\n"; }
+    }
+    LogMaintenance log_maintenance(repo, maintenance);
+    log_maintenance.start();
+
+    //Pushes room changes to open dashboards
+    RoomBroadcaster broadcaster(repo);
+    broadcaster.start();
+
     crow::SimpleApp app;
     app.loglevel(crow::LogLevel::Debug);
 
-    register_routes(app, repo);
+    register_routes(app, repo, ingestor, broadcaster);
 
     uint16_t port = 18080;
     if (const char* p = std::getenv("PORT")) {
@@ -35,5 +56,11 @@ int main() {
         std::cerr << "[FATAL] Crow failed to start: " << ex.what() << "\n";
         return 1;
     }
+
+    // Stop taking MQTT input, then commit whatever is still queued.
+    ingestor.stop();
+    broadcaster.stop();
+    log_maintenance.stop();
+    repo.flush();
     return 0;
 }
@@ -0,0 +1,176 @@
+#include "metrics.hpp"
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+    // Label values may hold anything; the format wants \, " and newline escaped.
+    void append_escaped(std::string& out, std::string_view v) {
+        for (char c : v) {
+            if (c == '\\') out += "\\\\";
+            else if (c == '"') out += "\\\"";
+            else if (c == '\n') out += "\\n";
+            else out += c;
+        }
+    }
+
+    void append_number(std::string& out, double v) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.9g", v);
+        out += buf;
+    }
+
+    // Counts stay exact however large they get.
+    void append_number(std::string& out, std::uint64_t v) {
+        char buf[24];
+        std::snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(v));
+        out += buf;
+    }
+
+    void append_header(std::string& out, std::string_view name, std::string_view help, const char* type) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    // name{labels} or name{labels,extra} (either may be empty) and the value
+    template <class T>
+    void append_sample(std::string& out, std::string_view name, std::string_view suffix,
+                       std::string_view labels, std::string_view extra, T value) {
+        out += name;
+        out += suffix;
+        if (!labels.empty() || !extra.empty()) {
+            out += '{';
+            out += labels;
+            if (!labels.empty() && !extra.empty()) out += ',';
+            out += extra;
+            out += '}';
+        }
+        out += ' ';
+        append_number(out, value);
+        out += '\n';
+    }
+
+    // _bucket samples on Histogram::kBoundsNs (then +Inf), _sum and _count.
+    void append_buckets(std::string& out, std::string_view name, std::string_view labels,
+                        const std::array<std::uint64_t, Histogram::kBuckets>& cumulative, double sum_seconds) {
+        for (std::size_t b = 0; b < Histogram::kBuckets; ++b) {
+            std::string le = "le=\"";
+            if (b < Histogram::kBoundsNs.size()) append_number(le, static_cast<double>(Histogram::kBoundsNs[b]) / 1e9);
+            else le += "+Inf";
+            le += '"';
+            append_sample(out, name, "_bucket", labels, le, cumulative[b]);
+        }
+        append_sample(out, name, "_sum", labels, "", sum_seconds);
+        append_sample(out, name, "_count", labels, "", cumulative.back());
+    }
+}
+
+Histogram::Totals Histogram::totals() const {
+    Totals t;
+    for (std::size_t s = 0; s < kMetricShards; ++s) {
+        for (std::size_t b = 0; b < kBuckets; ++b) t.buckets[b] += slots_[s].buckets[b].load(std::memory_order_relaxed);
+        t.sum_ns += slots_[s].sum_ns.load(std::memory_order_relaxed);
+    }
+    return t;
+}
+
+MetricsRegistry::Series& MetricsRegistry::series(std::string_view name, std::string_view help,
+                                                 bool is_histogram, const MetricLabels& labels) {
+    std::string rendered;
+    for (const auto& [key, value] : labels) {
+        if (!rendered.empty()) rendered += ',';
+        rendered += key;
+        rendered += "=\"";
+        append_escaped(rendered, value);
+        rendered += '"';
+    }
+
+    Family* family = nullptr;
+    for (auto& f : families_) {
+        if (f->name == name) family = f.get();
+    }
+    if (!family) {
+        families_.push_back(std::make_unique<Family>());
+        family = families_.back().get();
+        family->name = name;
+        family->help = help;
+        family->is_histogram = is_histogram;
+    } else if (family->is_histogram != is_histogram) {
+        throw std::logic_error("metric " + std::string(name) + " registered as both counter and histogram");
+    }
+
+    for (auto& s : family->series) {
+        if (s.labels == rendered) return s;
+    }
+    Series s;
+    s.labels = std::move(rendered);
+    if (is_histogram) s.histogram = std::make_unique<Histogram>();
+    else s.counter = std::make_unique<Counter>();
+    family->series.push_back(std::move(s));
+    return family->series.back();
+}
+
+Counter& MetricsRegistry::counter(std::string_view name, std::string_view help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return *series(name, help, false, labels).counter;
+}
+
+Histogram& MetricsRegistry::histogram(std::string_view name, std::string_view help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return *series(name, help, true, labels).histogram;
+}
+
+std::string MetricsRegistry::render() const {
+    std::string out;
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (const auto& f : families_) {
+        append_header(out, f->name, f->help, f->is_histogram ? "histogram" : "counter");
+        for (const auto& s : f->series) {
+            if (!f->is_histogram) {
+                append_sample(out, f->name, "", s.labels, "", s.counter->value());
+                continue;
+            }
+            const Histogram::Totals t = s.histogram->totals();
+            std::array<std::uint64_t, Histogram::kBuckets> cumulative{};
+            std::uint64_t running = 0;
+            for (std::size_t b = 0; b < Histogram::kBuckets; ++b) cumulative[b] = running += t.buckets[b];
+            append_buckets(out, f->name, s.labels, cumulative, static_cast<double>(t.sum_ns) / 1e9);
+        }
+    }
+    return out;
+}
+
+MetricsRegistry& metrics() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+void write_gauge(std::string& out, std::string_view name, std::string_view help, double value) {
+    append_header(out, name, help, "gauge");
+    append_sample(out, name, "", "", "", value);
+}
+
+void write_latency_histograms(std::string& out, std::string_view name, std::string_view help,
+                              std::string_view label, const LatencySeries& series) {
+    // Histogram's bounds in whole microseconds: a value of v us is at most
+    // b ns exactly when v <= b / 1000.
+    static const auto bounds_us = [] {
+        std::array<std::uint64_t, Histogram::kBoundsNs.size()> us{};
+        for (std::size_t b = 0; b < us.size(); ++b) us[b] = Histogram::kBoundsNs[b] / 1'000;
+        return us;
+    }();
+    append_header(out, name, help, "histogram");
+    for (const auto& [value, h] : series) {
+        std::string labels(label);
+        labels += "=\"";
+        append_escaped(labels, value);
+        labels += '"';
+        append_buckets(out, name, labels, h->cumulative(bounds_us), static_cast<double>(h->sum()) / 1e6);
+    }
+}
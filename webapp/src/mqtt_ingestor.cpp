@@ -7,7 +7,29 @@
 #include <thread>
 #include <atomic>
 #include <iostream>
+#include <cstring>
+#include <functional>
+#include <unistd.h>
 #include "repo.hpp"
+#include "state_codec.h"
+#include "state_payload.hpp"
+
+namespace {
+    // 2020-01-01T00:00:00Z; a smaller ts is a device clock since boot.
+    constexpr std::uint64_t kUnixMsFloor = 1577836800000ULL;
+
+    std::uint64_t micros_since(std::chrono::steady_clock::time_point t) {
+        const auto d = std::chrono::steady_clock::now() - t;
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+    }
+
+    void record_device_latency(LatencyHistogram& h, std::uint64_t ts_ms) {
+        if (ts_ms < kUnixMsFloor) return;
+        const auto now_ms = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        if (now_ms >= ts_ms) h.record((now_ms - ts_ms) * 1000);
+    }
+}
 
 // -------- ctor / dtor --------
 
@@ -15,12 +37,43 @@ MqttIngestor::MqttIngestor(Repo& repo,
                            std::string broker_host,
                            int broker_port,
                            std::string topic_filter,
-                           int qos)
+                           int qos,
+                           IngestOptions options)
     : repo_(repo),
       host_(std::move(broker_host)),
       port_(broker_port),
       topic_(std::move(topic_filter)),
-      qos_(qos) {}
+      qos_(qos),
+      options_(std::move(options)),
+      liveness_(repo, options_.liveness),
+      counters_{
+          metrics().counter("suction_mqtt_messages_received_total", "MQTT messages delivered by the broker."),
+          metrics().counter("suction_mqtt_messages_parsed_total", "MQTT messages parsed and queued for the Repo."),
+          metrics().counter("suction_mqtt_messages_failed_total", "MQTT messages dropped for a malformed topic or payload."),
+          metrics().counter("suction_mqtt_reconnects_total", "Unexpected MQTT disconnects (each followed by a reconnect attempt)."),
+      } {
+    if (options_.workers == 0) options_.workers = 1;
+    if (options_.share_group.empty() && options_.workers > 1) options_.share_group = "suction-ingest";
+    const std::string share = options_.share_group.empty() ? "" : "$share/" + options_.share_group + "/";
+    subscription_ = share + topic_;
+    if (!options_.binary_filter.empty()) extra_subscriptions_.push_back(share + options_.binary_filter);
+    if (!options_.status_filter.empty()) extra_subscriptions_.push_back(share + options_.status_filter);
+
+    const std::string client_prefix = options_.client_id + "-" + std::to_string(getpid()) + "-";
+    for (std::size_t i = 0; i < options_.workers; ++i) {
+        auto w = std::make_unique<Worker>(*this, options_.queue_capacity);
+        w->client_id = client_prefix + std::to_string(i);
+        workers_.push_back(std::move(w));
+    }
+    if (!share.empty()) {
+        replay_ = std::make_unique<Worker>(*this, 1);
+        replay_->client_id = client_prefix + "replay";
+        replay_->replay = true;
+        replay_subscriptions_.push_back(topic_);
+        if (!options_.binary_filter.empty()) replay_subscriptions_.push_back(options_.binary_filter);
+        if (!options_.status_filter.empty()) replay_subscriptions_.push_back(options_.status_filter);
+    }
+}
 
 MqttIngestor::~MqttIngestor() {
     stop();
@@ -34,32 +87,32 @@ bool MqttIngestor::start() {
 
     mosquitto_lib_init();
 
-    mosq_ = mosquitto_new("suction-ingestor", true /*clean session*/, this);
-    if (!mosq_) {
-        mosquitto_lib_cleanup();
-        return false;
-    }
-
-    mosquitto_connect_callback_set(mosq_, &MqttIngestor::on_connect);
-    mosquitto_message_callback_set(mosq_, &MqttIngestor::on_message);
-    mosquitto_disconnect_callback_set(mosq_, &MqttIngestor::on_disconnect);
-
-    // Optional: automatic reconnect (1s..10s, exponential backoff)
-    mosquitto_reconnect_delay_set(mosq_, 1, 10, true);
-
-    int rc = mosquitto_connect(mosq_, host_.c_str(), port_, 30 /* keepalive */);
-    if (rc != MOSQ_ERR_SUCCESS) {
-        mosquitto_destroy(mosq_);
-        mosq_ = nullptr;
-        mosquitto_lib_cleanup();
-        return false;
+    for (Worker* w : clients()) {
+        if (!connect_client(*w)) {
+            destroy_clients();
+            mosquitto_lib_cleanup();
+            return false;
+        }
     }
 
     running_.store(true);
-    // Run the blocking loop on a background thread.
-    loop_thread_ = std::thread([this]{
-        mosquitto_loop_forever(mosq_, -1 /* use defaults */, 1);
+    repo_.set_commit_observer([this](std::chrono::steady_clock::time_point received_at) {
+        latency_.committed.record(micros_since(received_at));
     });
+    liveness_.start();
+    // Consumers first, so nothing the network threads queue sits unread.
+    consuming_.store(true);
+    for (auto& w : workers_) {
+        Worker* wp = w.get();
+        wp->consumer_thread = std::thread([this, wp]{ consume_loop(*wp); });
+    }
+    // Run each client's blocking loop on its own background thread.
+    for (Worker* w : clients()) {
+        struct mosquitto* m = w->mosq;
+        w->loop_thread = std::thread([m]{
+            mosquitto_loop_forever(m, -1 /* use defaults */, 1);
+        });
+    }
 
     return true;
 }
@@ -67,73 +120,402 @@ bool MqttIngestor::start() {
 void MqttIngestor::stop() {
     if (!running_.exchange(false)) return;
 
-    if (mosq_) {
+    for (Worker* w : clients()) {
         // Trigger the loop to exit
-        mosquitto_disconnect(mosq_);
+        if (w->mosq) mosquitto_disconnect(w->mosq);
+    }
+    for (Worker* w : clients()) {
+        if (w->loop_thread.joinable()) w->loop_thread.join();
     }
-    if (loop_thread_.joinable()) {
-        loop_thread_.join();
+    // No more producers: let the consumers drain what is queued and exit.
+    consuming_.store(false);
+    for (auto& w : workers_) {
+        w->wake.fetch_add(1);
+        w->wake.notify_one();
     }
-    if (mosq_) {
-        mosquitto_destroy(mosq_);
-        mosq_ = nullptr;
+    for (auto& w : workers_) {
+        if (w->consumer_thread.joinable()) w->consumer_thread.join();
     }
+    liveness_.stop();
+    // Once flush() returns, no batch that copied the observer is still running.
+    repo_.set_commit_observer({});
+    repo_.flush();
+    destroy_clients();
     mosquitto_lib_cleanup();
 }
 
+bool MqttIngestor::connect_client(Worker& w) {
+    w.mosq = mosquitto_new(w.client_id.c_str(), true /*clean session*/, &w);
+    if (!w.mosq) return false;
+
+    mosquitto_connect_callback_set(w.mosq, &MqttIngestor::on_connect);
+    mosquitto_message_callback_set(w.mosq, &MqttIngestor::on_message);
+    mosquitto_disconnect_callback_set(w.mosq, &MqttIngestor::on_disconnect);
+
+    // Optional: automatic reconnect (1s..10s, exponential backoff)
+    mosquitto_reconnect_delay_set(w.mosq, 1, 10, true);
+
+    return mosquitto_connect(w.mosq, host_.c_str(), port_, 30 /* keepalive */) == MOSQ_ERR_SUCCESS;
+}
+
+std::vector<MqttIngestor::Worker*> MqttIngestor::clients() {
+    std::vector<Worker*> out;
+    for (auto& w : workers_) out.push_back(w.get());
+    if (replay_) out.push_back(replay_.get());
+    return out;
+}
+
+void MqttIngestor::destroy_clients() {
+    for (Worker* w : clients()) {
+        if (w->mosq) {
+            mosquitto_destroy(w->mosq);
+            w->mosq = nullptr;
+        }
+        w->connected.store(false);
+    }
+}
+
 // -------- static callbacks --------
 
 void MqttIngestor::on_connect(struct mosquitto* m, void* userdata, int rc) {
-    auto* self = static_cast<MqttIngestor*>(userdata);
-    if (!self) return;
+    auto* w = static_cast<Worker*>(userdata);
+    if (!w) return;
 
     if (rc == 0) {
-        // Connected: subscribe to the filter
-        mosquitto_subscribe(m, nullptr, self->topic_.c_str(), self->qos_);
+        w->connected.store(true);
+        if (w->replay) {
+            // Each (re)subscribe replays what is retained; nothing else is taken.
+            for (const auto& filter : w->owner.replay_subscriptions_) {
+                mosquitto_subscribe(m, nullptr, filter.c_str(), w->owner.qos_);
+            }
+            return;
+        }
+        // Connected: subscribe to the (possibly shared) filters
+        mosquitto_subscribe(m, nullptr, w->owner.subscription_.c_str(), w->owner.qos_);
+        for (const auto& filter : w->owner.extra_subscriptions_) {
+            mosquitto_subscribe(m, nullptr, filter.c_str(), w->owner.qos_);
+        }
     } else {
-        // (optional) log rc
+        std::cerr << "MQTT " << w->client_id << " connect failed (rc=" << rc << ")" << std::endl;
     }
 }
 
-void MqttIngestor::on_disconnect(struct mosquitto* /*m*/, void* /*userdata*/, int /*rc*/) {
-    // (optional) log or metrics
+void MqttIngestor::on_disconnect(struct mosquitto* /*m*/, void* userdata, int rc) {
+    auto* w = static_cast<Worker*>(userdata);
+    if (!w) return;
+    w->connected.store(false);
+    // rc 0 is our own mosquitto_disconnect(); anything else gets reconnected
+    if (rc != 0) w->owner.counters_.reconnects.inc();
 }
 
 void MqttIngestor::on_message(struct mosquitto* /*m*/,
                               void* userdata,
                               const struct mosquitto_message* msg) {
-    auto* self = static_cast<MqttIngestor*>(userdata);
-    if (!self || !msg || !msg->payload || msg->payloadlen <= 0) return;
-
-    try {
-        std::string topic = msg->topic ? std::string(msg->topic) : std::string();
-        std::string payload(static_cast<const char*>(msg->payload),
-                            static_cast<size_t>(msg->payloadlen));
-
-        // Expect "suction/<room>/state" → "<room>"
-        std::string room_number = extract_room_from_topic(topic);
-        if (room_number.empty()) {
-            return; // ignore malformed topic
+    const auto received_at = std::chrono::steady_clock::now();
+    auto* w = static_cast<Worker*>(userdata);
+    if (!w || !msg || !msg->payload || msg->payloadlen <= 0) return;
+    // Live messages reach the replay client too; the shared workers take those.
+    if (w->replay && !msg->retain) return;
+    MqttIngestor& self = w->owner;
+    self.counters_.received.inc();
+
+    // Views over mosquitto's buffers; nothing is copied until the enqueue.
+    std::string_view topic = msg->topic ? std::string_view(msg->topic) : std::string_view();
+    std::string_view payload(static_cast<const char*>(msg->payload),
+                             static_cast<size_t>(msg->payloadlen));
+
+    // Expect "suction/<room>/state" (or ".../state/bin", ".../status") → "<room>"
+    std::string_view room_number = room_from_topic(topic);
+    if (room_number.empty()) {
+        self.counters_.failed.inc();
+        return; // ignore malformed topic
+    }
+    if (room_number.size() > Update::kMaxRoom) {
+        std::cerr << "Ignoring MQTT message: room name too long in " << topic << std::endl;
+        self.counters_.failed.inc();
+        return;
+    }
+
+    Update u;
+    std::memcpy(u.room, room_number.data(), room_number.size());
+    u.room_len = static_cast<std::uint8_t>(room_number.size());
+    u.retained = msg->retain;
+    u.received_at = received_at;
+
+    if (topic.ends_with("/status")) {
+        // {"status":"online"|"offline"}; rare, so the general parser is fine
+        try {
+            nlohmann::json j = nlohmann::json::parse(payload.begin(), payload.end());
+            const std::string status = j.value("status", "");
+            if (status == "online") u.kind = Update::Kind::Online;
+            else if (status == "offline") u.kind = Update::Kind::Offline;
+            else {
+                self.counters_.failed.inc();
+                return;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error parsing MQTT status: " << e.what() << std::endl;
+            self.counters_.failed.inc();
+            return;
         }
+        self.counters_.parsed.inc();
+        w->received.fetch_add(1, std::memory_order_relaxed);
+        self.enqueue(self.shard_for(room_number), u);
+        return;
+    }
 
-        // Parse JSON: expect {"suction_on": true/false, ...}
-        nlohmann::json j = nlohmann::json::parse(payload);
-        bool suction_on = j.value("suction_on", false);
+    std::uint64_t ts = 0;
+    bool has_ts = false;
+    if (topic.ends_with("/state/bin")) {
+        suction_state_t bin;
+        const int rc = suction_state_decode(static_cast<const std::uint8_t*>(msg->payload),
+                                            payload.size(), &bin);
+        if (rc != SUCTION_STATE_OK) {
+            std::cerr << "Ignoring MQTT binary state on " << topic << " (error " << rc << ")" << std::endl;
+            self.counters_.failed.inc();
+            return;
+        }
+        u.suction_on = (bin.flags & SUCTION_STATE_FLAG_ON) != 0;
+        u.has_seq = true;
+        u.seq = bin.seq;
+        ts = bin.device_ms;
+        has_ts = true;
+    } else {
+        // Fast path for the firmware's {"suction_on":..,"motion":..,"seq":..,"ts":..};
+        // anything else goes through the general JSON parser.
+        StatePayload state;
+        if (parse_state_payload(payload, state)) {
+            u.suction_on = state.suction_on;
+            u.has_seq = state.has_seq;
+            u.seq = state.seq;
+            ts = state.ts;
+            has_ts = state.has_ts;
+        } else {
+            try {
+                nlohmann::json j = nlohmann::json::parse(payload.begin(), payload.end());
+                u.suction_on = j.value("suction_on", false);
+                if (auto it = j.find("seq"); it != j.end() && it->is_number_unsigned()) {
+                    u.has_seq = true;
+                    u.seq = it->get<std::uint32_t>();
+                }
+                if (auto it = j.find("ts"); it != j.end() && it->is_number_unsigned()) {
+                    ts = it->get<std::uint64_t>();
+                    has_ts = true;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Error parsing MQTT message: " << e.what() << std::endl;
+                self.counters_.failed.inc();
+                return;
+            }
+        }
+    }
+    if (has_ts && ts < kUnixMsFloor) {
+        u.has_uptime = true;
+        u.uptime_ms = ts;
+    }
+    // Retained replays are old by design; they would only skew the device stage.
+    if (has_ts && !u.retained) record_device_latency(self.latency_.device, ts);
+    self.latency_.parsed.record(micros_since(received_at));
+
+    self.counters_.parsed.inc();
+    w->received.fetch_add(1, std::memory_order_relaxed);
+    self.enqueue(self.shard_for(room_number), u);
+}
+
+// -------- stats --------
+
+namespace {
+    template <class W>
+    IngestStats snapshot(const W& w) {
+        return IngestStats{
+            w.queue.size_approx(),
+            w.queue.capacity(),
+            w.high_water.load(std::memory_order_relaxed),
+            w.received.load(std::memory_order_relaxed),
+            w.dropped.load(std::memory_order_relaxed),
+            w.processed.load(std::memory_order_relaxed),
+            w.coalesced.load(std::memory_order_relaxed),
+            w.duplicates.load(std::memory_order_relaxed),
+            w.applied.load(std::memory_order_relaxed),
+            w.seq_gaps.load(std::memory_order_relaxed),
+            w.out_of_order.load(std::memory_order_relaxed),
+            w.seq_resets.load(std::memory_order_relaxed),
+        };
+    }
+}
+
+IngestStats MqttIngestor::stats() const {
+    IngestStats total{};
+    for (const auto& w : workers_) {
+        const IngestStats s = snapshot(*w);
+        total.depth      += s.depth;
+        total.capacity   += s.capacity;
+        total.high_water += s.high_water;
+        total.received   += s.received;
+        total.dropped    += s.dropped;
+        total.processed  += s.processed;
+        total.coalesced  += s.coalesced;
+        total.duplicates += s.duplicates;
+        total.applied    += s.applied;
+        total.seq_gaps     += s.seq_gaps;
+        total.out_of_order += s.out_of_order;
+        total.seq_resets   += s.seq_resets;
+    }
+    if (replay_) total.received += replay_->received.load(std::memory_order_relaxed);
+    return total;
+}
+
+std::vector<WorkerStats> MqttIngestor::worker_stats() const {
+    std::vector<WorkerStats> out;
+    out.reserve(workers_.size());
+    for (const auto& w : workers_) {
+        out.push_back({w->client_id, w->connected.load(), snapshot(*w)});
+    }
+    if (replay_) {
+        WorkerStats r{replay_->client_id, replay_->connected.load(), {}};
+        r.ingest.received = replay_->received.load(std::memory_order_relaxed);
+        out.push_back(std::move(r));
+    }
+    return out;
+}
+
+// -------- ingest queue --------
+
+MqttIngestor::Worker& MqttIngestor::shard_for(std::string_view room_number) {
+    if (workers_.size() == 1) return *workers_.front();
+    return *workers_[std::hash<std::string_view>{}(room_number) % workers_.size()];
+}
 
-        int room_id = self->repo_.ensure_room_id(room_number);
-        if (room_id > 0) {
-            self->repo_.update_suction(room_id, suction_on);
+void MqttIngestor::enqueue(Worker& shard, Update& u) {
+    bool queued = shard.queue.try_push(u);
+    while (!queued) {
+        if (options_.overflow == OverflowPolicy::DropNewest) break;
+        if (options_.overflow == OverflowPolicy::DropOldest) {
+            Update evicted;
+            if (shard.queue.try_pop(evicted)) shard.dropped.fetch_add(1, std::memory_order_relaxed);
+        } else if (!consuming_.load()) {
+            break; // Block, but nobody is left to make room
+        } else {
+            std::this_thread::yield();
         }
-    } catch (const std::exception& e) {
-        std::cerr << "Error parsing MQTT message: " << e.what() << std::endl;
+        queued = shard.queue.try_push(u);
     }
+
+    if (!queued) {
+        const auto n = shard.dropped.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (n == 1 || n % 1000 == 0) {
+            std::cerr << "MQTT ingest queue full; " << n << " message(s) dropped so far" << std::endl;
+        }
+        return;
+    }
+
+    const std::size_t depth = shard.queue.size_approx();
+    std::size_t seen = shard.high_water.load(std::memory_order_relaxed);
+    while (depth > seen && !shard.high_water.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {}
+
+    shard.wake.fetch_add(1, std::memory_order_release);
+    shard.wake.notify_one();
 }
 
-std::string MqttIngestor::extract_room_from_topic(const std::string& topic) {
-    // naive split: "suction/OR 1/state"
-    auto first = topic.find('/');
-    if (first == std::string::npos) return {};
-    auto second = topic.find('/', first + 1);
-    if (second == std::string::npos) return {};
-    return topic.substr(first + 1, second - (first + 1)); // "OR 1"
+void MqttIngestor::consume_loop(Worker& w) {
+    Update u;
+    for (;;) {
+        // Read the wake counter before the final emptiness check so a push
+        // that lands in between still wakes us.
+        const std::uint32_t seen = w.wake.load(std::memory_order_acquire);
+        if (w.queue.try_pop(u)) {
+            // A burst started: give it the window to settle, then take
+            // everything queued by then in one go.
+            collect(w, u);
+            if (options_.coalesce_window.count() > 0 && consuming_.load()) {
+                std::this_thread::sleep_for(options_.coalesce_window);
+            }
+            while (w.queue.try_pop(u)) collect(w, u);
+            apply_pending(w);
+            continue;
+        }
+        if (!consuming_.load()) break;
+        w.wake.wait(seen, std::memory_order_acquire);
+    }
+}
+
+namespace {
+    constexpr std::int8_t kOn = 1;    // pending state is suction on
+    constexpr std::int8_t kFresh = 2; // a live (non-retained) state message arrived
+}
+
+void MqttIngestor::collect(Worker& w, const Update& u) {
+    w.processed.fetch_add(1, std::memory_order_relaxed);
+    // Only a state message makes a room: a status from a device that never
+    // reported state (or a stray publish) must not add a card.
+    const int room_id = u.kind == Update::Kind::State ? repo_.ensure_room_id(u.room_number())
+                                                      : repo_.find_room_id(u.room_number());
+    if (room_id <= 0) return;
+
+    const auto slot = static_cast<std::size_t>(room_id);
+    if (slot >= w.pending.size()) w.pending.resize(slot + 1, -1);
+
+    if (u.kind != Update::Kind::State) {
+        // Status supersedes any earlier state message's sign of life.
+        if (w.pending[slot] >= 0) w.pending[slot] &= ~kFresh;
+        if (u.kind == Update::Kind::Online) liveness_.seen(room_id);
+        else liveness_.offline(room_id);
+        return;
+    }
+
+    if (u.has_seq && !accept_seq(w, slot, u)) return;
+
+    std::int8_t fresh = u.retained ? 0 : kFresh;
+    if (w.pending[slot] < 0) {
+        w.touched.push_back(room_id);
+    } else {
+        w.coalesced.fetch_add(1, std::memory_order_relaxed);
+        fresh |= w.pending[slot] & kFresh;
+    }
+    if (slot >= w.pending_at.size()) w.pending_at.resize(slot + 1);
+    w.pending[slot] = static_cast<std::int8_t>((u.suction_on ? kOn : 0) | fresh);
+    w.pending_at[slot] = u.received_at;
+}
+
+// Orders a room's messages by the device's seq, which also covers two workers'
+// clients handing the same room's messages to its shard out of order.
+// Returns false for a message no newer than one already taken.
+bool MqttIngestor::accept_seq(Worker& w, std::size_t slot, const Update& u) {
+    const auto r = w.seq.check(slot, u.seq,
+                               u.has_uptime ? std::optional<std::uint64_t>(u.uptime_ms) : std::nullopt,
+                               u.received_at);
+    switch (r.verdict) {
+        case SeqTracker::Verdict::Stale:
+            w.out_of_order.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        case SeqTracker::Verdict::Reset:
+            w.seq_resets.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case SeqTracker::Verdict::Accept:
+            if (r.gap) w.seq_gaps.fetch_add(r.gap, std::memory_order_relaxed);
+            break;
+    }
+    return true;
+}
+
+void MqttIngestor::apply_pending(Worker& w) {
+    for (int room_id : w.touched) {
+        auto& slot = w.pending[static_cast<std::size_t>(room_id)];
+        const bool suction_on = (slot & kOn) != 0;
+        const bool fresh = (slot & kFresh) != 0;
+        if (fresh) liveness_.seen(room_id);
+        slot = -1;
+        // Retained replays and QoS 1 redeliveries usually repeat what we have.
+        // A live repeat still vouches for the state as of now (batch ordering).
+        if (repo_.suction_state(room_id) == suction_on) {
+            if (fresh) repo_.confirm_suction(room_id);
+            w.duplicates.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        const auto received_at = w.pending_at[static_cast<std::size_t>(room_id)];
+        repo_.update_suction(room_id, suction_on, received_at);
+        latency_.visible.record(micros_since(received_at));
+        w.applied.fetch_add(1, std::memory_order_relaxed);
+    }
+    w.touched.clear();
 }
@@ -0,0 +1,46 @@
+#include "read_pool.hpp"
+#include <crow.h>
+#include <algorithm>
+#include <thread>
+
+ReadPool::ReadPool(const std::string& db_path, std::size_t size) {
+    if (size == 0) size = std::max(2u, std::thread::hardware_concurrency());
+
+    conns_.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        sqlite3* db = nullptr;
+        const int flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX;
+        if (sqlite3_open_v2(db_path.c_str(), &db, flags, nullptr) != SQLITE_OK) {
+            CROW_LOG_ERROR << "Cannot open read connection: " << sqlite3_errmsg(db);
+            if (db) sqlite3_close(db);
+            break;
+        }
+        sqlite3_busy_timeout(db, 5000);
+        conns_.push_back({db, std::make_unique<StmtCache>(db)});
+    }
+    for (auto& c : conns_) idle_.push_back(&c);
+}
+
+ReadPool::~ReadPool() {
+    for (auto& c : conns_) {
+        c.stmts.reset(); // finalize before closing the connection
+        sqlite3_close(c.db);
+    }
+}
+
+ReadPool::Lease ReadPool::acquire() {
+    if (conns_.empty()) return Lease(*this, nullptr);
+    std::unique_lock<std::mutex> lk(mtx_);
+    cv_.wait(lk, [&]{ return !idle_.empty(); });
+    Conn* conn = idle_.back();
+    idle_.pop_back();
+    return Lease(*this, conn);
+}
+
+void ReadPool::release(Conn* conn) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        idle_.push_back(conn);
+    }
+    cv_.notify_one();
+}
@@ -1,17 +1,99 @@
 #include "repo.hpp"
 #include "util.hpp"
 #include <crow.h>
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <random>
 
 namespace {
-    void bind_text(sqlite3_stmt* s, int idx, const std::string& v) {
-        sqlite3_bind_text(s, idx, v.c_str(), -1, SQLITE_TRANSIENT);
+    void bind_text(sqlite3_stmt* s, int idx, std::string_view v) {
+        sqlite3_bind_text(s, idx, v.data(), static_cast<int>(v.size()), SQLITE_TRANSIENT);
+    }
+
+    constexpr std::int64_t kHour = 3600;
+
+    std::int64_t hour_floor(std::int64_t t) {
+        return t - (((t % kHour) + kHour) % kHour);
+    }
+
+    // Walks one room's log in timestamp order and buckets on-time and
+    // transitions by hour. Used for both rollups and live queries so the two
+    // can never disagree.
+    struct HourFolder {
+        std::int64_t cursor;
+        bool on;
+        std::map<std::int64_t, HourlyUsage> hours;
+
+        void add_on(std::int64_t a, std::int64_t b) {
+            while (a < b) {
+                const std::int64_t h = hour_floor(a);
+                const std::int64_t e = std::min(b, h + kHour);
+                bucket(h).on_seconds += static_cast<int>(e - a);
+                a = e;
+            }
+        }
+        void transition(std::int64_t ts, bool value) {
+            if (on) add_on(cursor, ts);
+            bucket(hour_floor(ts)).transitions++;
+            cursor = ts;
+            on = value;
+        }
+        void finish(std::int64_t until) {
+            if (on) add_on(cursor, until);
+            cursor = until;
+        }
+        HourlyUsage& bucket(std::int64_t h) {
+            return hours.try_emplace(h, HourlyUsage{h, 0, 0}).first->second;
+        }
+    };
+
+    // Where folding for a room starts: its rollup watermark, else the top of
+    // the hour of its first log row (off before that). False if it has no log.
+    bool fold_start(StmtCache& stmts, int room_id, std::int64_t& from, bool& on) {
+        if (auto s = stmts.get(Stmt::RollupState)) {
+            sqlite3_bind_int(s, 1, room_id);
+            if (sqlite3_step(s) == SQLITE_ROW) {
+                from = sqlite3_column_int64(s, 0);
+                on = sqlite3_column_int(s, 1) != 0;
+                return true;
+            }
+        }
+        if (auto s = stmts.get(Stmt::FirstLogTimestamp)) {
+            sqlite3_bind_int(s, 1, room_id);
+            if (sqlite3_step(s) == SQLITE_ROW && sqlite3_column_type(s, 0) != SQLITE_NULL) {
+                from = hour_floor(sqlite3_column_int64(s, 0));
+                on = false;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void fold_log(StmtCache& stmts, int room_id, std::int64_t until, HourFolder& folder) {
+        if (auto s = stmts.get(Stmt::LogRange)) {
+            sqlite3_bind_int(s, 1, room_id);
+            sqlite3_bind_int64(s, 2, folder.cursor);
+            sqlite3_bind_int64(s, 3, until);
+            while (sqlite3_step(s) == SQLITE_ROW) {
+                folder.transition(sqlite3_column_int64(s, 0), sqlite3_column_int(s, 1) != 0);
+            }
+        }
+        folder.finish(until);
     }
 }
 
-Repo::Repo(const std::string& db_path) { 
+Repo::Repo(const std::string& db_path,
+           WriteBehindOptions write_behind,
+           std::size_t read_connections)
+    : writer_wait_(metrics().histogram("suction_repo_writer_lock_wait_seconds",
+                                       "Time spent waiting for the SQLite writer connection's lock.")),
+      snapshot_(std::make_shared<const Snapshot>()),
+      wb_(write_behind) {
     if (sqlite3_open(db_path.c_str(), &db_) != SQLITE_OK) {
         CROW_LOG_ERROR << "Cannot open database: " << sqlite3_errmsg(db_);
         if (db_) { sqlite3_close(db_); db_ = nullptr; }
+        stmts_ = std::make_unique<StmtCache>(nullptr);
         return;
     }
     // Pragmas for sane defaults
@@ -22,73 +104,227 @@ Repo::Repo(const std::string& db_path) {
     if (err) { CROW_LOG_WARNING << "PRAGMA journal_mode: " << err; sqlite3_free(err); }
     sqlite3_exec(db_, "PRAGMA synchronous=NORMAL;", nullptr, nullptr, &err);
     if (err) { CROW_LOG_WARNING << "PRAGMA synchronous: " << err; sqlite3_free(err); }
+    sqlite3_busy_timeout(db_, 5000);
 
     init_schema();
+    stmts_ = std::make_unique<StmtCache>(db_);
+    readers_ = std::make_unique<ReadPool>(db_path, read_connections);
+
+    {
+        std::lock_guard<std::mutex> lk(snap_mtx_);
+        rebuild_snapshot(date_key(local_now()));
+    }
+    for (const auto& room : snapshot_.load()->rooms) remember_room_id(room->room_number, room->id);
+    flusher_ = std::thread([this]{ flush_loop(); });
 }
 
 Repo::~Repo() {
+    {
+        std::lock_guard<std::mutex> lk(queue_mtx_);
+        stop_ = true;
+    }
+    queue_cv_.notify_one();
+    if (flusher_.joinable()) flusher_.join(); // commits whatever is still queued
+
+    readers_.reset();
+    stmts_.reset(); // finalize before closing the connection
     if (db_) sqlite3_close(db_);
 }
 
-void Repo::exec_ddl(const char* sql) {
+template <class F>
+auto Repo::with_reader(F&& f) {
+    if (readers_) {
+        if (auto conn = readers_->acquire()) return f(conn.stmts());
+    }
+    auto lk = lock_writer();
+    return f(*stmts_);
+}
+
+bool Repo::exec_ddl(const char* sql) {
     char* err = nullptr;
     if (sqlite3_exec(db_, sql, nullptr, nullptr, &err) != SQLITE_OK) {
         CROW_LOG_ERROR << "DDL failed: " << (err ? err : "(unknown)");
         if (err) sqlite3_free(err);
+        return false;
     }
+    return true;
 }
 
-//This created the 4 tables for our DB
-void Repo::init_schema() {
-    const char* create_rooms = R"(
+namespace {
+    // Bump when the schema changes and add a step to Repo::init_schema().
+    constexpr int kSchemaVersion = 2;
+
+    // Times are integers: room_schedule.date is local YYYYMMDD, start/end_time
+    // are minutes since local midnight, and log/state timestamps are Unix seconds.
+    const char* kCreateRooms = R"(
         CREATE TABLE IF NOT EXISTS rooms (
             id INTEGER PRIMARY KEY AUTOINCREMENT,
             room_number TEXT UNIQUE NOT NULL
         );
     )";
-    const char* create_room_schedule = R"(
+    const char* kCreateRoomSchedule = R"(
         CREATE TABLE IF NOT EXISTS room_schedule (
             id INTEGER PRIMARY KEY AUTOINCREMENT,
             room_id INTEGER NOT NULL,
             procedure TEXT,
-            start_time TEXT,
-            end_time  TEXT,
-            date      TEXT,
+            start_time INTEGER,
+            end_time  INTEGER,
+            date      INTEGER,
             FOREIGN KEY (room_id) REFERENCES rooms(id) ON DELETE CASCADE
         );
+        CREATE INDEX IF NOT EXISTS idx_room_schedule_room_date
+            ON room_schedule(room_id, date, start_time);
     )";
-    const char* create_suction_state = R"(
+    const char* kCreateSuctionState = R"(
         CREATE TABLE IF NOT EXISTS suction_state (
             room_id INTEGER PRIMARY KEY,
             suction_on INTEGER NOT NULL DEFAULT 0,
-            last_updated TEXT,
+            last_updated INTEGER,
             FOREIGN KEY (room_id) REFERENCES rooms(id) ON DELETE CASCADE
         );
     )";
-    const char* create_suction_log = R"(
+    const char* kCreateSuctionLog = R"(
         CREATE TABLE IF NOT EXISTS suction_log (
             id INTEGER PRIMARY KEY AUTOINCREMENT,
             room_id INTEGER,
-            timestamp TEXT,
+            timestamp INTEGER,
             suction_on INTEGER,
             FOREIGN KEY (room_id) REFERENCES rooms(id) ON DELETE CASCADE
         );
+        CREATE INDEX IF NOT EXISTS idx_suction_log_room_ts
+            ON suction_log(room_id, timestamp);
+    )";
+
+    // Hourly on-time per room, folded out of suction_log by rollup_hourly().
+    // hour is Unix seconds at the top of the hour; rolled_until marks how far
+    // each room's log has been folded and the state in effect at that instant.
+    const char* kCreateSuctionHourly = R"(
+        CREATE TABLE IF NOT EXISTS suction_hourly (
+            room_id INTEGER NOT NULL,
+            hour INTEGER NOT NULL,
+            on_seconds INTEGER NOT NULL,
+            transitions INTEGER NOT NULL,
+            PRIMARY KEY (room_id, hour)
+        ) WITHOUT ROWID;
+        CREATE TABLE IF NOT EXISTS suction_rollup_state (
+            room_id INTEGER PRIMARY KEY,
+            rolled_until INTEGER NOT NULL,
+            suction_on INTEGER NOT NULL
+        );
+    )";
+
+    // Version 0 stored "HH:MM", "YYYY-MM-DD" and local "YYYY-MM-DD HH:MM:SS" text.
+    const char* kMigrateToV1 = R"(
+        ALTER TABLE room_schedule RENAME TO room_schedule_v0;
+        ALTER TABLE suction_state RENAME TO suction_state_v0;
+        ALTER TABLE suction_log RENAME TO suction_log_v0;
     )";
-    exec_ddl(create_rooms);
-    exec_ddl(create_room_schedule);
-    exec_ddl(create_suction_state);
-    exec_ddl(create_suction_log);
+    const char* kCopyFromV0 = R"(
+        INSERT INTO room_schedule (id, room_id, procedure, start_time, end_time, date)
+        SELECT id, room_id, procedure,
+               CASE WHEN start_time GLOB '[0-9][0-9]:[0-9][0-9]*'
+                    THEN CAST(substr(start_time, 1, 2) AS INTEGER) * 60
+                       + CAST(substr(start_time, 4, 2) AS INTEGER) END,
+               CASE WHEN end_time GLOB '[0-9][0-9]:[0-9][0-9]*'
+                    THEN CAST(substr(end_time, 1, 2) AS INTEGER) * 60
+                       + CAST(substr(end_time, 4, 2) AS INTEGER) END,
+               CAST(replace(date, '-', '') AS INTEGER)
+        FROM room_schedule_v0;
+        INSERT INTO suction_state (room_id, suction_on, last_updated)
+        SELECT room_id, suction_on, CAST(strftime('%s', last_updated, 'utc') AS INTEGER)
+        FROM suction_state_v0;
+        INSERT INTO suction_log (id, room_id, timestamp, suction_on)
+        SELECT id, room_id, CAST(strftime('%s', timestamp, 'utc') AS INTEGER), suction_on
+        FROM suction_log_v0;
+        DROP TABLE room_schedule_v0;
+        DROP TABLE suction_state_v0;
+        DROP TABLE suction_log_v0;
+    )";
+}
+
+int Repo::schema_version() {
+    int version = 0;
+    sqlite3_stmt* s = nullptr;
+    if (sqlite3_prepare_v2(db_, "PRAGMA user_version", -1, &s, nullptr) == SQLITE_OK
+        && sqlite3_step(s) == SQLITE_ROW) {
+        version = sqlite3_column_int(s, 0);
+    }
+    sqlite3_finalize(s);
+    return version;
+}
+
+//Runs `steps` and sets user_version = `to` in one transaction.
+bool Repo::migrate_to(int to, const std::vector<const char*>& steps) {
+    if (!exec_ddl("BEGIN IMMEDIATE;")) return false;
+    bool ok = true;
+    for (const char* sql : steps) {
+        if (!(ok = exec_ddl(sql))) break;
+    }
+    const std::string bump = "PRAGMA user_version = " + std::to_string(to) + ";";
+    ok = ok && exec_ddl(bump.c_str()) && exec_ddl("COMMIT;");
+    if (!ok) exec_ddl("ROLLBACK;");
+    return ok;
+}
+
+//Creates the tables for our DB, or migrates an older file in place.
+//Each migration step runs in its own transaction and bumps PRAGMA user_version.
+void Repo::init_schema() {
+    const int version = schema_version();
+    if (version > kSchemaVersion) {
+        CROW_LOG_WARNING << "Database schema v" << version << " is newer than this build (v"
+                         << kSchemaVersion << ")";
+        return;
+    }
+
+    if (version == kSchemaVersion) {
+        CROW_LOG_INFO << "Database schema ready.";
+        return;
+    }
+
+    // Table rebuilds need FK enforcement off, and that can't change inside a transaction.
+    exec_ddl("PRAGMA foreign_keys = OFF;");
+    bool ok = true;
+
+    // v0 -> v1: integer times + indexes. A v0 file is one that has tables but
+    // no user_version; a brand-new file just gets the current schema.
+    if (ok && version < 1) {
+        bool legacy = false;
+        sqlite3_stmt* s = nullptr;
+        if (sqlite3_prepare_v2(db_, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'suction_log'",
+                               -1, &s, nullptr) == SQLITE_OK) {
+            legacy = sqlite3_step(s) == SQLITE_ROW;
+        }
+        sqlite3_finalize(s);
+
+        std::vector<const char*> steps;
+        if (legacy) steps.push_back(kMigrateToV1);
+        steps.insert(steps.end(), {kCreateRooms, kCreateRoomSchedule, kCreateSuctionState, kCreateSuctionLog});
+        if (legacy) steps.push_back(kCopyFromV0);
+        ok = migrate_to(1, steps);
+        if (ok && legacy) CROW_LOG_INFO << "Migrated database schema v0 -> v1.";
+    }
+
+    // v1 -> v2: hourly rollups of suction_log
+    if (ok && version < 2) ok = migrate_to(2, {kCreateSuctionHourly});
+
+    exec_ddl("PRAGMA foreign_keys = ON;");
+    if (!ok) {
+        CROW_LOG_ERROR << "Schema migration failed; database left at v" << schema_version();
+        return;
+    }
     CROW_LOG_INFO << "Database schema ready.";
 }
 
 //initilaize the DB with mock OR Data
 void Repo::seed_if_empty() {
-    const char* count_sql = "SELECT COUNT(*) FROM rooms";
-    sqlite3_stmt* s = nullptr;
-    if (sqlite3_prepare_v2(db_, count_sql, -1, &s, nullptr) != SQLITE_OK) return;
-    sqlite3_step(s);
-    int count = sqlite3_column_int(s, 0);
-    sqlite3_finalize(s);
+    int count = 0;
+    {
+        auto lk = lock_writer();
+        auto s = stmts_->get(Stmt::CountRooms);
+        if (!s) return;
+        sqlite3_step(s);
+        count = sqlite3_column_int(s, 0);
+    }
     if (count != 0) return;
     // this is where we setup initial data of our database
     std::vector<OperatingRoom> seed = {
@@ -105,199 +341,518 @@ void Repo::seed_if_empty() {
         insert_room(r);
 
         // Get assigned id
-        sqlite3_stmt* t = nullptr;
-        if (sqlite3_prepare_v2(db_, "SELECT id FROM rooms WHERE room_number = ? LIMIT 1", -1, &t, nullptr) == SQLITE_OK) {
-            bind_text(t, 1, r.room_number);
-            int id = 0;
-            if (sqlite3_step(t) == SQLITE_ROW) id = sqlite3_column_int(t, 0);
-            sqlite3_finalize(t);
-            if (id > 0) log_suction_status(id, r.suction_on);
+        int id = 0;
+        {
+            auto lk = lock_writer();
+            if (auto t = stmts_->get(Stmt::RoomIdByNumber)) {
+                bind_text(t, 1, r.room_number);
+                if (sqlite3_step(t) == SQLITE_ROW) id = sqlite3_column_int(t, 0);
+            }
         }
+        if (id > 0) log_suction_status(id, r.suction_on);
     }
     CROW_LOG_INFO << "Seeded initial room data.";
 }
 
 //This feeds our UI
-//For each room, get its current OR event and read its latest suction status
+//Reads the current snapshot and resolves each room's active OR event for "now".
 std::vector<OperatingRoom> Repo::load_rooms() {
-    std::lock_guard<std::mutex> lk(mtx_);
+    const std::tm now = local_now();
+    const int minute_now = now.tm_hour * 60 + now.tm_min;
+    auto snap = snapshot_for(date_key(now));
+
     std::vector<OperatingRoom> rooms;
-    const char* sql = "SELECT id, room_number FROM rooms ORDER BY id";
-    sqlite3_stmt* s = nullptr;
-    if (sqlite3_prepare_v2(db_, sql, -1, &s, nullptr) != SQLITE_OK) return rooms;
+    rooms.reserve(snap->rooms.size());
+    for (const auto& state : snap->rooms) {
+        rooms.push_back(to_operating_room(*state, minute_now));
+    }
+    return rooms;
+}
+
+std::optional<OperatingRoom> Repo::load_room(int room_id) {
+    const std::tm now = local_now();
+    auto room = find_room(*snapshot_for(date_key(now)), room_id);
+    if (!room) return std::nullopt;
+    return to_operating_room(*room, now.tm_hour * 60 + now.tm_min);
+}
+
+//Answers from one snapshot and its version. Journal entries newer than the
+//snapshot are left for the next call, which asks from this version.
+std::uint32_t Repo::new_epoch() {
+    std::random_device rd;
+    std::uint32_t e = rd() ^ static_cast<std::uint32_t>(epoch_seconds());
+    return e ? e : 1;
+}
+
+RoomChanges Repo::changes_since(std::uint32_t epoch, std::uint64_t since, std::int64_t since_minute) {
+    const std::int64_t now_s = epoch_seconds();
+    const std::tm now = local_time(now_s);
+    const int minute_now = now.tm_hour * 60 + now.tm_min;
+    auto snap = snapshot_for(date_key(now));
+
+    RoomChanges out;
+    out.epoch = epoch_;
+    out.version = snap->version;
+    out.minute = now_s / 60;
+
+    // Versions from before a restart look like ours but mean something else.
+    bool full = epoch != epoch_ || since > snap->version;
+    std::vector<int> written;
+    if (!full) {
+        std::lock_guard<std::mutex> lk(journal_mtx_);
+        full = since < journal_floor_;
+        for (auto it = journal_.rbegin(); !full && it != journal_.rend() && it->version > since; ++it) {
+            if (it->version > snap->version) continue;
+            if (it->room_id == 0) full = true;
+            else written.push_back(it->room_id);
+        }
+    }
+
+    // Schedules from another day are not in this snapshot at all.
+    int minute_then = -1;
+    if (!full && since_minute > 0 && since_minute != out.minute) {
+        const std::tm then = local_time(since_minute * 60);
+        if (date_key(then) != snap->date) full = true;
+        else minute_then = then.tm_hour * 60 + then.tm_min;
+    }
+
+    out.full = full;
+    if (!full && written.empty() && minute_then < 0) return out;
+    std::sort(written.begin(), written.end());
+    for (const auto& state : snap->rooms) {
+        const bool changed = full ||
+            std::binary_search(written.begin(), written.end(), state->id) ||
+            (minute_then >= 0 && state->schedule.active_at(minute_then) != state->schedule.active_at(minute_now));
+        if (changed) out.rooms.push_back(to_operating_room(*state, minute_now));
+    }
+    return out;
+}
+
+void Repo::set_change_listener(ChangeListener listener) {
+    std::lock_guard<std::mutex> lk(snap_mtx_);
+    change_listener_ = std::move(listener);
+}
+
+//The current snapshot, rebuilt first if the day rolled over: today's
+//schedules need one trip to the DB.
+std::shared_ptr<const Repo::Snapshot> Repo::snapshot_for(int today) {
+    auto snap = snapshot_.load(std::memory_order_acquire);
+    if (snap->date != today) {
+        std::lock_guard<std::mutex> lk(snap_mtx_);
+        snap = snapshot_.load(std::memory_order_acquire);
+        if (snap->date != today) {
+            rebuild_snapshot(today);
+            snap = snapshot_.load(std::memory_order_acquire);
+        }
+    }
+    return snap;
+}
+
+OperatingRoom Repo::to_operating_room(const RoomState& state, int minute_now) {
+    OperatingRoom room{};
+    room.id = state.id;
+    room.room_number = state.room_number;
+
+    // current procedure window if now is between start_time and end_time
+    if (const auto* current = state.schedule.active_at(minute_now)) {
+        room.procedure = current->procedure;
+        room.schedule  = format_minutes(current->start_min) + " - " + format_minutes(current->end_min);
+    } else {
+        room.procedure = "Idle / Unscheduled";
+        room.schedule  = "—";
+    }
+    room.suction_on = state.suction_on;
+    room.stale = state.stale;
+    return room;
+}
+
+//Reloads every room from the DB into a fresh snapshot for `date`.
+//Suction states already in memory win: the DB may still be behind the queue.
+void Repo::rebuild_snapshot(int date) {
+    auto rooms = with_reader([&](StmtCache& stmts) { return read_room_states(stmts, date, 0); });
+
+    auto cur = snapshot_.load(std::memory_order_acquire);
+    auto snap = std::make_shared<Snapshot>();
+    snap->date = date;
+    snap->rooms.reserve(rooms.size());
+    for (auto& room : rooms) {
+        if (auto known = find_room(*cur, room.id)) {
+            room.suction_on = known->suction_on;
+            room.stale = known->stale;
+        }
+        snap->rooms.push_back(std::make_shared<const RoomState>(std::move(room)));
+    }
+    snap->version = version_.load(std::memory_order_relaxed) + 1;
+    record_change(snap->version, 0);
+    const std::uint64_t version = snap->version;
+    snapshot_.store(std::move(snap), std::memory_order_release);
+    version_.store(version, std::memory_order_release);
+    if (change_listener_) change_listener_(0);
+}
+
+std::shared_ptr<const Repo::RoomState> Repo::find_room(const Snapshot& snap, int room_id) {
+    auto it = std::lower_bound(snap.rooms.begin(), snap.rooms.end(), room_id,
+        [](const std::shared_ptr<const RoomState>& r, int id) { return r->id < id; });
+    if (it == snap.rooms.end() || (*it)->id != room_id) return nullptr;
+    return *it;
+}
+
+//Swaps in a snapshot where `room` replaces (or is added as) the entry with its id.
+//Unchanged rooms are shared with the previous snapshot, so this copies pointers only.
+void Repo::publish_room(RoomState room) {
+    auto cur = snapshot_.load(std::memory_order_acquire);
+    auto next = std::make_shared<Snapshot>(*cur);
+    auto it = std::lower_bound(next->rooms.begin(), next->rooms.end(), room.id,
+        [](const std::shared_ptr<const RoomState>& r, int id) { return r->id < id; });
+    auto fresh = std::make_shared<const RoomState>(std::move(room));
+    const int fresh_id = fresh->id;
+    if (it != next->rooms.end() && (*it)->id == fresh->id) {
+        *it = std::move(fresh);
+    } else {
+        next->rooms.insert(it, std::move(fresh));
+    }
+    next->version = version_.load(std::memory_order_relaxed) + 1;
+    record_change(next->version, fresh_id);
+    const std::uint64_t version = next->version;
+    snapshot_.store(std::move(next), std::memory_order_release);
+    version_.store(version, std::memory_order_release);
+    if (change_listener_) change_listener_(fresh_id);
+}
+
+//Journaled ahead of the store, so whoever sees a snapshot also finds the
+//entries up to its version.
+void Repo::record_change(std::uint64_t version, int room_id) {
+    std::lock_guard<std::mutex> lk(journal_mtx_);
+    if (journal_.size() == kJournalSize) {
+        journal_floor_ = journal_.front().version;
+        journal_.pop_front();
+    }
+    journal_.push_back({version, room_id});
+}
+
+//Reads rooms with their suction state and the schedule windows for `date`
+//(plus the day before's, for overnight windows) in one set-based query, and
+//indexes each room's schedule. room_id > 0 restricts the read to that room.
+std::vector<Repo::RoomState> Repo::read_room_states(StmtCache& stmts, int date, int room_id) {
+    std::vector<RoomState> rooms;
+    auto s = stmts.get(room_id > 0 ? Stmt::RoomStateById : Stmt::RoomStates);
+    if (!s) return rooms;
+    sqlite3_bind_int(s, 1, date);
+    if (room_id > 0) sqlite3_bind_int(s, 2, room_id);
+    sqlite3_bind_int(s, 3, add_days(date, -1));
+
+    auto text = [&](int col) {
+        auto p = sqlite3_column_text(s, col);
+        return std::string(p ? reinterpret_cast<const char*>(p) : "");
+    };
 
     while (sqlite3_step(s) == SQLITE_ROW) {
-        OperatingRoom room{};
-        room.id = sqlite3_column_int(s, 0);
-        auto txt = sqlite3_column_text(s, 1);
-        room.room_number = txt ? reinterpret_cast<const char*>(txt) : "";
-
-        RoomEvent current = get_current_event_for_room(room.id);
-        if (current.active) {
-            room.procedure = current.procedure;
-            room.schedule  = current.start_time + " - " + current.end_time;
-        } else {
-            room.procedure = "Idle / Unscheduled";
-            room.schedule  = "—";
+        const int id = sqlite3_column_int(s, 0);
+        if (rooms.empty() || rooms.back().id != id) {
+            RoomState room;
+            room.id = id;
+            room.room_number = text(1);
+            room.suction_on = sqlite3_column_int(s, 2) != 0;
+            rooms.push_back(std::move(room));
+        }
+        // rs.id is NULL when the room has nothing scheduled on `date`;
+        // windows without both ends can never be active, so skip those too
+        if (sqlite3_column_type(s, 3) != SQLITE_NULL
+            && sqlite3_column_type(s, 5) != SQLITE_NULL
+            && sqlite3_column_type(s, 6) != SQLITE_NULL) {
+            ScheduleIndex::Window w{text(4), sqlite3_column_int(s, 5), sqlite3_column_int(s, 6)};
+            if (sqlite3_column_int(s, 7) == date) rooms.back().schedule.add(std::move(w));
+            else rooms.back().schedule.add_carryover(std::move(w));
         }
-        room.suction_on = get_latest_suction_status(room.id);
-        rooms.push_back(room);
     }
-    sqlite3_finalize(s);
+    for (auto& room : rooms) room.schedule.build();
     return rooms;
 }
 
-//returns current procedure window if now is between start_time and end_time
-RoomEvent Repo::get_current_event_for_room(int room_id) {
-    RoomEvent event{"Idle", "", "", false};
-
-    // current date/time
-    const auto now = std::chrono::system_clock::now();
-    const std::time_t t = std::chrono::system_clock::to_time_t(now);
-    std::tm local_tm{};
-#if defined(_WIN32)
-    localtime_s(&local_tm, &t);
-#else
-    localtime_r(&t, &local_tm);
-#endif
-    char date_buf[11];
-    char time_buf[6];
-    std::strftime(date_buf, sizeof(date_buf), "%Y-%m-%d", &local_tm);
-    std::strftime(time_buf, sizeof(time_buf), "%H:%M", &local_tm);
-
-    const char* sql = R"(
-        SELECT procedure, start_time, end_time
-        FROM room_schedule
-        WHERE room_id = ? AND date = ?
-        ORDER BY start_time;
-    )";
+//Re-reads one room's number and schedule from the DB into the snapshot.
+void Repo::refresh_room(int room_id) {
+    std::lock_guard<std::mutex> snap_lk(snap_mtx_);
+    auto snap = snapshot_.load(std::memory_order_acquire);
+    RoomState room = with_reader([&](StmtCache& stmts) {
+        return read_room_state(stmts, room_id, snap->date);
+    });
+    if (room.id == 0) return;
+    if (auto known = find_room(*snap, room_id)) {
+        room.suction_on = known->suction_on;
+        room.stale = known->stale;
+    }
+    publish_room(std::move(room));
+}
 
-    sqlite3_stmt* s = nullptr;
-    if (sqlite3_prepare_v2(db_, sql, -1, &s, nullptr) == SQLITE_OK) {
-        sqlite3_bind_int(s, 1, room_id);
-        bind_text(s, 2, date_buf);
-
-        while (sqlite3_step(s) == SQLITE_ROW) {
-            auto p0 = sqlite3_column_text(s, 0);
-            auto p1 = sqlite3_column_text(s, 1);
-            auto p2 = sqlite3_column_text(s, 2);
-            std::string proc  = p0 ? reinterpret_cast<const char*>(p0) : "";
-            std::string start = p1 ? reinterpret_cast<const char*>(p1) : "";
-            std::string end   = p2 ? reinterpret_cast<const char*>(p2) : "";
-
-            if (!start.empty() && !end.empty()
-                && std::string(time_buf) >= start
-                && std::string(time_buf) <= end) {
-                event = {proc, start, end, true};
-                break;
-            }
-        }
+std::optional<bool> Repo::suction_state(int room_id) const {
+    auto room = find_room(*snapshot_.load(std::memory_order_acquire), room_id);
+    if (!room) return std::nullopt;
+    return room->suction_on;
+}
+
+//Reads one room from the DB; id 0 if it does not exist.
+Repo::RoomState Repo::read_room_state(StmtCache& stmts, int room_id, int date) {
+    auto rooms = read_room_states(stmts, date, room_id);
+    if (rooms.empty()) return RoomState{};
+    return std::move(rooms.front());
+}
+
+//Publishes the new state to the snapshot and queues the DB write.
+//Unknown room ids are dropped here rather than failing the FK later.
+void Repo::update_suction(int room_id, bool suction_on,
+                          std::chrono::steady_clock::time_point origin) {
+    std::lock_guard<std::mutex> snap_lk(snap_mtx_);
+    auto room = find_room(*snapshot_.load(std::memory_order_acquire), room_id);
+    if (!room) {
+        CROW_LOG_WARNING << "update_suction: unknown room id " << room_id;
+        return;
+    }
+    if (room->suction_on != suction_on) {
+        RoomState next = *room;
+        next.suction_on = suction_on;
+        publish_room(std::move(next));
+    }
+
+    // Still under snap_mtx_, so the queue sees updates in snapshot order.
+    {
+        std::lock_guard<std::mutex> lk(queue_mtx_);
+        queue_.push_back({++queued_seq_, room_id, suction_on, std::max(epoch_seconds(), stamp_floor_),
+                          std::chrono::steady_clock::now(), origin});
     }
-    if (s) sqlite3_finalize(s);
-    return event;
+    queue_cv_.notify_one();
 }
 
-//reads suction_state; if missing, falls back to the latest suction_log
-bool Repo::get_latest_suction_status(int room_id) {
-    const char* sql = "SELECT suction_on FROM suction_state WHERE room_id = ?";
-    sqlite3_stmt* s = nullptr;
-    bool result = false;
-    if (sqlite3_prepare_v2(db_, sql, -1, &s, nullptr) == SQLITE_OK) {
-        sqlite3_bind_int(s, 1, room_id);
-        if (sqlite3_step(s) == SQLITE_ROW) {
-            result = sqlite3_column_int(s, 0) != 0;
+void Repo::confirm_suction(int room_id) {
+    const std::int64_t now = epoch_seconds();
+    std::lock_guard<std::mutex> lk(confirmed_mtx_);
+    auto& at = confirmed_[room_id];
+    at = std::max(at, now);
+}
+
+void Repo::set_room_stale(int room_id, bool stale) {
+    std::lock_guard<std::mutex> snap_lk(snap_mtx_);
+    auto room = find_room(*snapshot_.load(std::memory_order_acquire), room_id);
+    if (!room || room->stale == stale) return;
+    RoomState next = *room;
+    next.stale = stale;
+    publish_room(std::move(next));
+}
+
+//Each room's watermark and last update are read once, inside the
+//transaction, and then advanced as the batch writes to it.
+std::vector<SuctionUpdateStatus> Repo::update_suction_batch(const std::vector<SuctionUpdate>& updates) {
+    using Status = SuctionUpdateStatus;
+    constexpr std::int64_t kMaxClockSkew = 60; // seconds a device clock may run ahead
+
+    std::vector<Status> status(updates.size(), Status::Applied);
+    if (updates.empty()) return status;
+    std::vector<std::size_t> order(updates.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return updates[a].timestamp < updates[b].timestamp;
+    });
+
+    // Held throughout: no update_suction() can slip in between our reads and
+    // the snapshot swap. The flusher never takes it, so flush() can finish.
+    std::lock_guard<std::mutex> snap_lk(snap_mtx_);
+    flush();
+    const auto snap = snapshot_.load(std::memory_order_acquire);
+    const std::int64_t latest = epoch_seconds() + kMaxClockSkew;
+
+    std::map<int, bool> final_state; // room -> state after the batch
+    struct Bounds {
+        std::int64_t rolled_until = 0; // rollup watermark
+        std::int64_t last_updated = 0; // latest update, including this batch's
+    };
+    std::unordered_map<int, Bounds> bounds; // read once per room
+    bool committed = false;
+    {
+        auto lk = lock_writer();
+        auto run = [&](Stmt id) {
+            auto s = stmts_->get(id);
+            return s && sqlite3_step(s) == SQLITE_DONE;
+        };
+        if (!run(Stmt::Begin)) {
+            CROW_LOG_ERROR << "BEGIN failed: " << sqlite3_errmsg(db_);
+            std::fill(status.begin(), status.end(), Status::Failed);
+            return status;
+        }
+        for (std::size_t i : order) {
+            const SuctionUpdate& u = updates[i];
+            if (!find_room(*snap, u.room_id)) { status[i] = Status::UnknownRoom; continue; }
+            if (u.timestamp > latest) { status[i] = Status::InFuture; continue; }
+
+            auto [it, first] = bounds.try_emplace(u.room_id);
+            Bounds& room = it->second;
+            if (first) {
+                if (auto s = stmts_->get(Stmt::RollupState)) {
+                    sqlite3_bind_int(s, 1, u.room_id);
+                    if (sqlite3_step(s) == SQLITE_ROW) room.rolled_until = sqlite3_column_int64(s, 0);
+                }
+                if (auto s = stmts_->get(Stmt::SuctionState)) {
+                    sqlite3_bind_int(s, 1, u.room_id);
+                    if (sqlite3_step(s) == SQLITE_ROW) room.last_updated = sqlite3_column_int64(s, 1);
+                }
+                // A re-confirmed state counts as written when it was confirmed.
+                std::lock_guard<std::mutex> confirmed_lk(confirmed_mtx_);
+                if (auto c = confirmed_.find(u.room_id); c != confirmed_.end()) {
+                    room.last_updated = std::max(room.last_updated, c->second);
+                }
+            }
+            if (u.timestamp < room.rolled_until) { status[i] = Status::RolledUp; continue; }
+            if (u.timestamp < room.last_updated) { status[i] = Status::OutOfOrder; continue; }
+
+            write_suction(u.room_id, u.suction_on, u.timestamp);
+            room.last_updated = u.timestamp;
+            final_state[u.room_id] = u.suction_on;
+        }
+        committed = run(Stmt::Commit);
+        if (!committed) {
+            CROW_LOG_ERROR << "COMMIT failed, suction batch of " << updates.size()
+                           << " rejected: " << sqlite3_errmsg(db_);
+            run(Stmt::Rollback);
         }
     }
-    if (s) sqlite3_finalize(s);
 
-    if (!result) {
-        const char* log_sql =
-            "SELECT suction_on FROM suction_log WHERE room_id = ? ORDER BY id DESC LIMIT 1";
-        if (sqlite3_prepare_v2(db_, log_sql, -1, &s, nullptr) == SQLITE_OK) {
-            sqlite3_bind_int(s, 1, room_id);
-            if (sqlite3_step(s) == SQLITE_ROW) {
-                result = sqlite3_column_int(s, 0) != 0;
+    if (!committed) {
+        std::replace(status.begin(), status.end(), Status::Applied, Status::Failed);
+        return status;
+    }
+    for (const auto& [room_id, on] : final_state) {
+        auto room = find_room(*snapshot_.load(std::memory_order_acquire), room_id);
+        if (!room || room->suction_on == on) continue;
+        RoomState next = *room;
+        next.suction_on = on;
+        publish_room(std::move(next));
+    }
+    return status;
+}
+
+void Repo::set_commit_observer(CommitObserver observer) {
+    std::lock_guard<std::mutex> lk(queue_mtx_);
+    commit_observer_ = std::move(observer);
+}
+
+void Repo::flush() {
+    std::unique_lock<std::mutex> lk(queue_mtx_);
+    const std::uint64_t target = queued_seq_;
+    ++flush_waiters_;
+    queue_cv_.notify_one();
+    flushed_cv_.wait(lk, [&]{ return flushed_seq_ >= target; });
+    --flush_waiters_;
+}
+
+//Flusher thread: waits until a batch is full, the oldest update is max_delay
+//old, or someone is blocked in flush(), then commits up to max_batch updates.
+void Repo::flush_loop() {
+    std::vector<PendingSuction> batch;
+    std::unique_lock<std::mutex> lk(queue_mtx_);
+    for (;;) {
+        queue_cv_.wait(lk, [&]{ return stop_ || !queue_.empty(); });
+        if (queue_.empty()) return; // stopping, and everything is committed
+
+        const auto deadline = queue_.front().queued_at + wb_.max_delay;
+        queue_cv_.wait_until(lk, deadline, [&]{
+            return stop_ || flush_waiters_ > 0 || queue_.size() >= wb_.max_batch;
+        });
+
+        const auto n = static_cast<std::ptrdiff_t>(std::min(queue_.size(), wb_.max_batch));
+        batch.assign(std::make_move_iterator(queue_.begin()),
+                     std::make_move_iterator(queue_.begin() + n));
+        queue_.erase(queue_.begin(), queue_.begin() + n);
+        const CommitObserver observer = commit_observer_;
+
+        lk.unlock();
+        if (apply_suction_batch(batch) && observer) {
+            for (const auto& u : batch) {
+                if (u.origin != std::chrono::steady_clock::time_point{}) observer(u.origin);
             }
         }
-        if (s) sqlite3_finalize(s);
+        lk.lock();
+
+        flushed_seq_ = batch.back().seq;
+        flushed_cv_.notify_all();
     }
-    return result;
 }
 
-//Reads existing state; if changed or missing, appends to suction_log with current timestamp.
-//Update suction_state with the new value and last_updated.
-void Repo::update_suction(int room_id, bool suction_on) {
-    std::lock_guard<std::mutex> lk(mtx_);
+//Commits a batch of queued updates in a single transaction.
+bool Repo::apply_suction_batch(const std::vector<PendingSuction>& batch) {
+    auto lk = lock_writer();
 
+    auto run = [&](Stmt id) {
+        auto s = stmts_->get(id);
+        return s && sqlite3_step(s) == SQLITE_DONE;
+    };
+    const bool in_txn = run(Stmt::Begin);
+    if (!in_txn) {
+        // Still write the batch, one autocommit per statement, rather than drop it.
+        CROW_LOG_ERROR << "BEGIN failed: " << sqlite3_errmsg(db_);
+    }
+    for (const auto& u : batch) write_suction(u.room_id, u.suction_on, u.timestamp);
+    if (in_txn && !run(Stmt::Commit)) {
+        CROW_LOG_ERROR << "COMMIT failed, " << batch.size() << " suction updates lost: "
+                       << sqlite3_errmsg(db_);
+        run(Stmt::Rollback);
+        return false;
+    }
+    return true;
+}
+
+//Reads existing state; if changed or missing, appends to suction_log with the update's timestamp.
+//Update suction_state with the new value and last_updated.
+void Repo::write_suction(int room_id, bool suction_on, std::int64_t timestamp) {
     // Read current
-    const char* select_sql = "SELECT suction_on FROM suction_state WHERE room_id = ?";
-    sqlite3_stmt* s = nullptr;
-    sqlite3_prepare_v2(db_, select_sql, -1, &s, nullptr);
-    sqlite3_bind_int(s, 1, room_id);
     bool prev = false;
     bool exists = false;
-    if (sqlite3_step(s) == SQLITE_ROW) {
-        prev = sqlite3_column_int(s, 0);
-        exists = true;
+    if (auto s = stmts_->get(Stmt::SuctionState)) {
+        sqlite3_bind_int(s, 1, room_id);
+        if (sqlite3_step(s) == SQLITE_ROW) {
+            prev = sqlite3_column_int(s, 0);
+            exists = true;
+        }
     }
-    sqlite3_finalize(s);
 
     if (!exists || prev != suction_on) {
-        const char* log_sql =
-            "INSERT INTO suction_log (room_id, timestamp, suction_on) VALUES (?, ?, ?)";
-        sqlite3_prepare_v2(db_, log_sql, -1, &s, nullptr);
+        if (auto s = stmts_->get(Stmt::InsertSuctionLog)) {
+            sqlite3_bind_int(s, 1, room_id);
+            sqlite3_bind_int64(s, 2, timestamp);
+            sqlite3_bind_int(s, 3, suction_on ? 1 : 0);
+            sqlite3_step(s);
+        }
+    }
+
+    if (auto s = stmts_->get(Stmt::UpsertSuctionState)) {
         sqlite3_bind_int(s, 1, room_id);
-        bind_text(s, 2, format_timestamp());
-        sqlite3_bind_int(s, 3, suction_on ? 1 : 0);
+        sqlite3_bind_int(s, 2, suction_on ? 1 : 0);
+        sqlite3_bind_int64(s, 3, timestamp);
         sqlite3_step(s);
-        sqlite3_finalize(s);
     }
-
-    const char* upsert_sql = R"(
-        INSERT INTO suction_state (room_id, suction_on, last_updated)
-        VALUES (?, ?, ?)
-        ON CONFLICT(room_id) DO UPDATE SET
-            suction_on=excluded.suction_on,
-            last_updated=excluded.last_updated;
-    )";
-    sqlite3_prepare_v2(db_, upsert_sql, -1, &s, nullptr);
-    sqlite3_bind_int(s, 1, room_id);
-    sqlite3_bind_int(s, 2, suction_on ? 1 : 0);
-    bind_text(s, 3, format_timestamp());
-    sqlite3_step(s);
-    sqlite3_finalize(s);
 }
 
 //Insert a new room into the UI
 void Repo::insert_room(const OperatingRoom& r) {
     // Insert (ignore if exists)
     {
-        std::lock_guard<std::mutex> lk(mtx_);
-        const char* sql = "INSERT OR IGNORE INTO rooms (room_number) VALUES (?)";
-        sqlite3_stmt* s = nullptr;
-        if (sqlite3_prepare_v2(db_, sql, -1, &s, nullptr) == SQLITE_OK) {
+        auto lk = lock_writer();
+        if (auto s = stmts_->get(Stmt::InsertRoom)) {
             bind_text(s, 1, r.room_number);
             sqlite3_step(s);
         }
-        if (s) sqlite3_finalize(s);
     }
 
     // Get room id
     int room_id = 0;
     {
-        std::lock_guard<std::mutex> lk(mtx_);
-        const char* sel = "SELECT id FROM rooms WHERE room_number = ? LIMIT 1";
-        sqlite3_stmt* s = nullptr;
-        if (sqlite3_prepare_v2(db_, sel, -1, &s, nullptr) == SQLITE_OK) {
+        auto lk = lock_writer();
+        if (auto s = stmts_->get(Stmt::RoomIdByNumber)) {
             bind_text(s, 1, r.room_number);
             if (sqlite3_step(s) == SQLITE_ROW) room_id = sqlite3_column_int(s, 0);
         }
-        if (s) sqlite3_finalize(s);
     }
     if (room_id <= 0) return;
 
     // If schedule is provided in "HH:MM - HH:MM", insert today's entry
-    std::string start, end;
+    int start = -1, end = -1;
     if (!r.schedule.empty()) {
         size_t dash = r.schedule.find('-');
         if (dash != std::string::npos) {
@@ -307,68 +862,228 @@ void Repo::insert_room(const OperatingRoom& r) {
                 if (a == std::string::npos) return std::string();
                 return s.substr(a, b - a + 1);
             };
-            start = trim(r.schedule.substr(0, dash));
-            end   = trim(r.schedule.substr(dash + 1));
+            start = parse_hhmm(trim(r.schedule.substr(0, dash)));
+            end   = parse_hhmm(trim(r.schedule.substr(dash + 1)));
         }
     }
 
     // today's date
-    const auto now = std::chrono::system_clock::now();
-    const std::time_t tt = std::chrono::system_clock::to_time_t(now);
-    std::tm local_tm{};
-#if defined(_WIN32)
-    localtime_s(&local_tm, &tt);
-#else
-    localtime_r(&tt, &local_tm);
-#endif
-    char date_buf[11];
-    std::strftime(date_buf, sizeof(date_buf), "%Y-%m-%d", &local_tm);
-
-    std::lock_guard<std::mutex> lk(mtx_);
-    const char* insert_schedule_sql = R"(
-        INSERT INTO room_schedule (room_id, procedure, start_time, end_time, date)
-        VALUES (?, ?, ?, ?, ?)
-    )";
-    sqlite3_stmt* s = nullptr;
-    if (sqlite3_prepare_v2(db_, insert_schedule_sql, -1, &s, nullptr) == SQLITE_OK) {
-        sqlite3_bind_int(s, 1, room_id);
-        bind_text(s, 2, r.procedure);
-        if (!start.empty()) bind_text(s, 3, start); else sqlite3_bind_null(s, 3);
-        if (!end.empty())   bind_text(s, 4, end);   else sqlite3_bind_null(s, 4);
-        bind_text(s, 5, date_buf);
-        sqlite3_step(s);
+    const int date = date_key(local_now());
+
+    {
+        auto lk = lock_writer();
+        if (auto s = stmts_->get(Stmt::InsertSchedule)) {
+            sqlite3_bind_int(s, 1, room_id);
+            bind_text(s, 2, r.procedure);
+            if (start >= 0) sqlite3_bind_int(s, 3, start); else sqlite3_bind_null(s, 3);
+            if (end >= 0)   sqlite3_bind_int(s, 4, end);   else sqlite3_bind_null(s, 4);
+            sqlite3_bind_int(s, 5, date);
+            sqlite3_step(s);
+        }
     }
-    if (s) sqlite3_finalize(s);
+
+    // Into the snapshot before the id can be looked up (see ensure_room_id).
+    refresh_room(room_id);
+    remember_room_id(r.room_number, room_id);
 }
 
 void Repo::log_suction_status(int room_id, bool suction_on) {
-    update_suction(room_id, suction_on); // already logs + upserts
+    update_suction(room_id, suction_on); // already logs + upserts (via the queue)
 }
 
 //Resolve room id
-int Repo::ensure_room_id(const std::string& room_number) {
+int Repo::cached_room_id(std::string_view room_number) {
+    std::shared_lock<std::shared_mutex> lk(ids_mtx_);
+    auto it = room_ids_.find(room_number);
+    return it == room_ids_.end() ? 0 : it->second;
+}
+
+void Repo::remember_room_id(std::string_view room_number, int room_id) {
+    std::unique_lock<std::shared_mutex> lk(ids_mtx_);
+    room_ids_.emplace(room_number, room_id);
+}
+
+//Called for every MQTT message: known rooms resolve from memory, only a
+//genuinely new room_number touches the database.
+int Repo::ensure_room_id(std::string_view room_number) {
+    if (int id = cached_room_id(room_number)) return id;
+
     int room_id = 0;
     {
-        std::lock_guard<std::mutex> lk(mtx_);
+        auto lk = lock_writer();
         // Create if missing
-        const char* insert_sql = "INSERT OR IGNORE INTO rooms (room_number) VALUES (?)";
-        sqlite3_stmt* s = nullptr;
-        if (sqlite3_prepare_v2(db_, insert_sql, -1, &s, nullptr) == SQLITE_OK) {
+        if (auto s = stmts_->get(Stmt::InsertRoom)) {
             bind_text(s, 1, room_number);
             sqlite3_step(s);
         }
-        if (s) sqlite3_finalize(s);
 
         // Fetch id
-        const char* sel = "SELECT id FROM rooms WHERE room_number = ? LIMIT 1";
-        s = nullptr;
-        if (sqlite3_prepare_v2(db_, sel, -1, &s, nullptr) == SQLITE_OK) {
+        if (auto s = stmts_->get(Stmt::RoomIdByNumber)) {
             bind_text(s, 1, room_number);
             if (sqlite3_step(s) == SQLITE_ROW) {
                 room_id = sqlite3_column_int(s, 0);
             }
         }
-        if (s) sqlite3_finalize(s);
+
     }
+    if (room_id <= 0) return 0;
+    // Snapshot first: once the id can be looked up, update_suction() must find
+    // the room. Also covers a concurrent caller that created it but has not
+    // published it yet.
+    if (!find_room(*snapshot_.load(std::memory_order_acquire), room_id)) refresh_room(room_id);
+    remember_room_id(room_number, room_id);
     return room_id;
 }
+
+int Repo::find_room_id(std::string_view room_number) {
+    // Every room is in the cache: it is filled from the snapshot at startup
+    // and by every insert since.
+    return cached_room_id(room_number);
+}
+
+//Folds complete hours of each room's log into suction_hourly and moves the
+//room's watermark to the top of the current hour.
+int Repo::rollup_hourly(std::int64_t now) {
+    // From here on updates are stamped at `until` or later, so once the ones
+    // already queued are in the log, nothing can still arrive for the hours
+    // about to be folded (even if the clock steps back).
+    const std::int64_t until = hour_floor(now);
+    {
+        std::lock_guard<std::mutex> lk(queue_mtx_);
+        stamp_floor_ = std::max(stamp_floor_, until);
+    }
+    flush();
+
+    std::vector<int> ids;
+    {
+        auto lk = lock_writer();
+        if (auto s = stmts_->get(Stmt::RoomIds)) {
+            while (sqlite3_step(s) == SQLITE_ROW) ids.push_back(sqlite3_column_int(s, 0));
+        }
+    }
+
+    int advanced = 0;
+    for (int id : ids) {
+        // One room per lock/transaction so ingest commits can interleave.
+        auto lk = lock_writer();
+        std::int64_t from = 0;
+        bool on = false;
+        if (!fold_start(*stmts_, id, from, on) || from >= until) continue;
+
+        HourFolder folder{from, on, {}};
+        fold_log(*stmts_, id, until, folder);
+
+        auto run = [&](Stmt stmt) {
+            auto s = stmts_->get(stmt);
+            return s && sqlite3_step(s) == SQLITE_DONE;
+        };
+        if (!run(Stmt::Begin)) continue;
+        bool ok = true;
+        for (const auto& [hour, usage] : folder.hours) {
+            auto s = stmts_->get(Stmt::UpsertHourly);
+            if (!s) { ok = false; break; }
+            sqlite3_bind_int(s, 1, id);
+            sqlite3_bind_int64(s, 2, hour);
+            sqlite3_bind_int(s, 3, usage.on_seconds);
+            sqlite3_bind_int(s, 4, usage.transitions);
+            if (!(ok = sqlite3_step(s) == SQLITE_DONE)) break;
+        }
+        if (ok) {
+            auto s = stmts_->get(Stmt::UpsertRollupState);
+            ok = s;
+            if (ok) {
+                sqlite3_bind_int(s, 1, id);
+                sqlite3_bind_int64(s, 2, until);
+                sqlite3_bind_int(s, 3, folder.on ? 1 : 0);
+                ok = sqlite3_step(s) == SQLITE_DONE;
+            }
+        }
+        if (ok && run(Stmt::Commit)) {
+            ++advanced;
+        } else {
+            CROW_LOG_ERROR << "Rollup failed for room " << id << ": " << sqlite3_errmsg(db_);
+            run(Stmt::Rollback);
+        }
+    }
+    return advanced;
+}
+
+//Ages out raw rows in small autocommitted chunks instead of one long DELETE.
+std::size_t Repo::prune_suction_log(std::int64_t cutoff, int batch) {
+    std::size_t total = 0;
+    for (;;) {
+        auto lk = lock_writer();
+        auto s = stmts_->get(Stmt::PruneSuctionLog);
+        if (!s) break;
+        sqlite3_bind_int64(s, 1, cutoff);
+        sqlite3_bind_int(s, 2, batch);
+        if (sqlite3_step(s) != SQLITE_DONE) {
+            CROW_LOG_ERROR << "Pruning suction_log failed: " << sqlite3_errmsg(db_);
+            break;
+        }
+        const int n = sqlite3_changes(db_);
+        total += static_cast<std::size_t>(n);
+        if (n < batch) break;
+    }
+    return total;
+}
+
+std::vector<HourlyUsage> Repo::hourly_usage(int room_id, std::int64_t from, std::int64_t to) {
+    const std::int64_t from_h = hour_floor(from);
+    const std::int64_t to_h = hour_floor(to - 1) + kHour;
+    const std::int64_t now = epoch_seconds();
+
+    return with_reader([&](StmtCache& stmts) {
+        std::vector<HourlyUsage> out;
+        std::int64_t start = 0;
+        bool on = false;
+        if (!fold_start(stmts, room_id, start, on)) return out;
+
+        // Hours before the watermark are already in suction_hourly.
+        if (auto s = stmts.get(Stmt::HourlyRange)) {
+            sqlite3_bind_int(s, 1, room_id);
+            sqlite3_bind_int64(s, 2, from_h);
+            sqlite3_bind_int64(s, 3, std::min(to_h, start));
+            while (sqlite3_step(s) == SQLITE_ROW) {
+                out.push_back({sqlite3_column_int64(s, 0), sqlite3_column_int(s, 1),
+                               sqlite3_column_int(s, 2)});
+            }
+        }
+
+        // The rest (normally just the current hour) comes from the raw log.
+        const std::int64_t until = std::min(to_h, now);
+        if (until > start) {
+            HourFolder folder{start, on, {}};
+            fold_log(stmts, room_id, until, folder);
+            for (const auto& [hour, usage] : folder.hours) {
+                if (hour >= from_h) out.push_back(usage);
+            }
+        }
+        return out;
+    });
+}
+
+std::vector<SuctionEvent> Repo::suction_history(int room_id, std::int64_t from, std::int64_t to,
+                                                std::int64_t after_ts, std::int64_t after_id,
+                                                int limit) {
+    // Start no earlier than `from`: (from, 0) sorts before every row at `from`.
+    if (after_ts < from) {
+        after_ts = from;
+        after_id = 0;
+    }
+    return with_reader([&](StmtCache& stmts) {
+        std::vector<SuctionEvent> out;
+        if (auto s = stmts.get(Stmt::LogPage)) {
+            sqlite3_bind_int(s, 1, room_id);
+            sqlite3_bind_int64(s, 2, after_ts);
+            sqlite3_bind_int64(s, 3, after_id);
+            sqlite3_bind_int64(s, 4, to);
+            sqlite3_bind_int(s, 5, limit);
+            while (sqlite3_step(s) == SQLITE_ROW) {
+                out.push_back({sqlite3_column_int64(s, 0), sqlite3_column_int(s, 1) != 0,
+                               sqlite3_column_int64(s, 2)});
+            }
+        }
+        return out;
+    });
+}
@@ -0,0 +1,128 @@
+#include "room_broadcaster.hpp"
+#include "repo.hpp"
+#include "room_json.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
+RoomBroadcaster::RoomBroadcaster(Repo& repo) : repo_(repo) {}
+
+RoomBroadcaster::~RoomBroadcaster() {
+    stop();
+}
+
+void RoomBroadcaster::start() {
+    if (thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = false;
+    }
+    repo_.set_change_listener([this](int room_id) { room_changed(room_id); });
+    thread_ = std::thread([this]{ loop(); });
+}
+
+void RoomBroadcaster::stop() {
+    if (!thread_.joinable()) return;
+    // Detach first: set_change_listener() takes the snapshot lock, so no
+    // listener call is still running once it returns.
+    repo_.set_change_listener({});
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void RoomBroadcaster::subscribe(const void* key, Send send) {
+    std::lock_guard<std::mutex> lk(subs_mtx_);
+    // Under subs_mtx_, so no delta can reach this subscriber ahead of it.
+    send(full_message());
+    ++sent_;
+    subs_[key] = std::move(send);
+}
+
+void RoomBroadcaster::unsubscribe(const void* key) {
+    std::lock_guard<std::mutex> lk(subs_mtx_);
+    subs_.erase(key);
+}
+
+std::size_t RoomBroadcaster::subscribers() const {
+    std::lock_guard<std::mutex> lk(subs_mtx_);
+    return subs_.size();
+}
+
+std::uint64_t RoomBroadcaster::messages_sent() const {
+    std::lock_guard<std::mutex> lk(subs_mtx_);
+    return sent_;
+}
+
+void RoomBroadcaster::room_changed(int room_id) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (room_id == 0) all_changed_ = true;
+        else changed_.push_back(room_id);
+    }
+    cv_.notify_one();
+}
+
+std::string RoomBroadcaster::full_message() const {
+    crow::json::wvalue msg = rooms_to_json(repo_.load_rooms());
+    msg["type"] = "rooms";
+    return msg.dump();
+}
+
+void RoomBroadcaster::send_all(const std::string& message) {
+    for (auto& [key, send] : subs_) send(message);
+    sent_ += subs_.size();
+}
+
+//Sender thread: turns the rooms changed since the last round into one delta
+//(or a full list after a reload), and resends the full list at each minute
+//boundary, when procedures and schedule windows can change without any write.
+void RoomBroadcaster::loop() {
+    using Clock = std::chrono::system_clock;
+    auto next_minute = [] { return std::chrono::ceil<std::chrono::minutes>(Clock::now() + std::chrono::milliseconds(1)); };
+
+    std::vector<int> changed;
+    auto refresh_at = next_minute();
+    std::unique_lock<std::mutex> lk(mtx_);
+    while (!stop_) {
+        cv_.wait_until(lk, refresh_at, [&]{ return stop_ || all_changed_ || !changed_.empty(); });
+        if (stop_) break;
+
+        const bool full = all_changed_ || Clock::now() >= refresh_at;
+        if (full) refresh_at = next_minute();
+        changed.swap(changed_);
+        changed_.clear();
+        all_changed_ = false;
+        lk.unlock();
+
+        {
+            std::lock_guard<std::mutex> subs_lk(subs_mtx_);
+            if (!subs_.empty()) {
+                if (full) {
+                    send_all(full_message());
+                } else {
+                    std::sort(changed.begin(), changed.end());
+                    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+                    crow::json::wvalue::list rooms;
+                    rooms.reserve(changed.size());
+                    for (int id : changed) {
+                        if (auto room = repo_.load_room(id)) rooms.push_back(room_to_json(*room));
+                    }
+                    if (!rooms.empty()) {
+                        crow::json::wvalue msg;
+                        msg["type"] = "delta";
+                        msg["rooms"] = std::move(rooms);
+                        msg["generatedAt"] = format_timestamp();
+                        send_all(msg.dump());
+                    }
+                }
+            }
+        }
+        changed.clear();
+        lk.lock();
+    }
+}
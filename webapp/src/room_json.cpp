@@ -0,0 +1,23 @@
+#include "room_json.hpp"
+#include "util.hpp"
+
+crow::json::wvalue room_to_json(const OperatingRoom& room) {
+    crow::json::wvalue item;
+    item["id"]         = room.id;
+    item["roomNumber"] = room.room_number;
+    item["procedure"]  = room.procedure;
+    item["schedule"]   = room.schedule;
+    item["suctionOn"]  = room.suction_on;
+    item["stale"]      = room.stale;
+    return item;
+}
+
+crow::json::wvalue rooms_to_json(const std::vector<OperatingRoom>& rooms) {
+    crow::json::wvalue::list list;
+    list.reserve(rooms.size());
+    for (const auto& room : rooms) list.push_back(room_to_json(room));
+    crow::json::wvalue payload;
+    payload["rooms"] = std::move(list);
+    payload["generatedAt"] = format_timestamp();
+    return payload;
+}
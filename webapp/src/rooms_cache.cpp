@@ -0,0 +1,56 @@
+#include "rooms_cache.hpp"
+#include "repo.hpp"
+#include "room_json.hpp"
+#include "util.hpp"
+#include <cstdio>
+
+RoomsBody::RoomsBody(std::uint32_t epoch, std::uint64_t version, std::int64_t minute, std::string json)
+    : version_(version),
+      minute_(minute),
+      etag_(RoomsResponseCache::make_etag(epoch, version, minute)),
+      json_(std::move(json)) {}
+
+const std::string& RoomsBody::encoded(Encoding& e) const {
+    if (e == Encoding::Brotli) {
+        std::call_once(brotli_once_, [&]{ brotli_ = brotli_compress(json_); });
+        if (!brotli_.empty() && brotli_.size() < json_.size()) return brotli_;
+    } else if (e == Encoding::Gzip) {
+        std::call_once(gzip_once_, [&]{ gzip_ = gzip_compress(json_); });
+        if (!gzip_.empty() && gzip_.size() < json_.size()) return gzip_;
+    }
+    e = Encoding::Identity;
+    return json_;
+}
+
+std::string RoomsResponseCache::make_etag(std::uint32_t epoch, std::uint64_t version, std::int64_t minute) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "\"%08lx-%llu-%lld\"", static_cast<unsigned long>(epoch),
+                  static_cast<unsigned long long>(version), static_cast<long long>(minute));
+    return buf;
+}
+
+// Version first: a body is never older than its tag.
+std::string RoomsResponseCache::current_etag() const {
+    const std::uint64_t version = repo_.state_version();
+    return make_etag(repo_.epoch(), version, epoch_seconds() / 60);
+}
+
+std::shared_ptr<const RoomsBody> RoomsResponseCache::get() {
+    const std::uint64_t arrived = repo_.state_version();
+    const std::int64_t minute = epoch_seconds() / 60;
+    auto fresh_enough = [&](const std::shared_ptr<const RoomsBody>& b) {
+        return b && b->minute() == minute && b->version() >= arrived;
+    };
+
+    auto cur = current_.load(std::memory_order_acquire);
+    if (fresh_enough(cur)) return cur;
+
+    std::lock_guard<std::mutex> lk(build_mtx_);
+    cur = current_.load(std::memory_order_acquire);
+    if (fresh_enough(cur)) return cur; // someone built it while we waited
+
+    const std::uint64_t version = repo_.state_version();
+    auto next = std::make_shared<const RoomsBody>(repo_.epoch(), version, minute, rooms_to_json(repo_.load_rooms()).dump());
+    current_.store(next, std::memory_order_release);
+    return next;
+}
@@ -0,0 +1,60 @@
+#include "schedule_index.hpp"
+#include <algorithm>
+
+namespace {
+    constexpr int kLastMinute = 24 * 60 - 1;
+}
+
+void ScheduleIndex::add(Window w) {
+    const int from = w.start_min;
+    const int to = w.end_min < w.start_min ? kLastMinute : w.end_min;
+    windows_.push_back(std::move(w));
+    pieces_.push_back({from, to, windows_.size() - 1});
+}
+
+void ScheduleIndex::add_carryover(Window w) {
+    if (w.end_min >= w.start_min) return; // ended yesterday
+    const int to = w.end_min;
+    windows_.push_back(std::move(w));
+    pieces_.push_back({0, to, windows_.size() - 1});
+}
+
+void ScheduleIndex::build() {
+    // Earliest start wins an overlap; carry-overs start at 0 so they rank first.
+    std::stable_sort(pieces_.begin(), pieces_.end(),
+                     [](const Piece& a, const Piece& b) { return a.from < b.from; });
+
+    // Cut the day at every boundary, give each elementary segment to the first
+    // piece covering it and merge neighbours won by the same window. A room
+    // has a handful of windows, so the quadratic pass is cheaper than a heap.
+    std::vector<int> cuts;
+    cuts.reserve(pieces_.size() * 2);
+    for (const auto& p : pieces_) {
+        cuts.push_back(p.from);
+        cuts.push_back(p.to + 1);
+    }
+    std::sort(cuts.begin(), cuts.end());
+    cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+
+    slots_.clear();
+    for (std::size_t i = 0; i + 1 < cuts.size(); ++i) {
+        const int from = cuts[i];
+        const int to = cuts[i + 1] - 1;
+        auto owner = std::find_if(pieces_.begin(), pieces_.end(),
+                                  [&](const Piece& p) { return p.from <= from && to <= p.to; });
+        if (owner == pieces_.end()) continue;
+        if (!slots_.empty() && slots_.back().window == owner->window && slots_.back().to + 1 == from) {
+            slots_.back().to = to;
+        } else {
+            slots_.push_back({from, to, owner->window});
+        }
+    }
+}
+
+const ScheduleIndex::Window* ScheduleIndex::active_at(int minute) const {
+    auto it = std::upper_bound(slots_.begin(), slots_.end(), minute,
+                               [](int m, const Piece& s) { return m < s.from; });
+    if (it == slots_.begin()) return nullptr;
+    --it;
+    return minute <= it->to ? &windows_[it->window] : nullptr;
+}
@@ -0,0 +1,97 @@
+#include "state_payload.hpp"
+#include <charconv>
+#include <cstddef>
+#include <limits>
+
+namespace {
+    struct Cursor {
+        std::string_view in;
+        std::size_t pos = 0;
+
+        void skip_ws() {
+            while (pos < in.size() && (in[pos] == ' ' || in[pos] == '\t' || in[pos] == '\n' || in[pos] == '\r')) ++pos;
+        }
+        bool eat(char c) {
+            skip_ws();
+            if (pos < in.size() && in[pos] == c) { ++pos; return true; }
+            return false;
+        }
+        bool eat_word(std::string_view w) {
+            if (in.substr(pos, w.size()) != w) return false;
+            pos += w.size();
+            return true;
+        }
+        // A key without escapes; escaped keys are not ours anyway.
+        bool key(std::string_view& out) {
+            if (!eat('"')) return false;
+            const std::size_t end = in.find('"', pos);
+            if (end == std::string_view::npos) return false;
+            out = in.substr(pos, end - pos);
+            if (out.find('\\') != std::string_view::npos) return false;
+            pos = end + 1;
+            return true;
+        }
+        bool boolean(bool& out) {
+            skip_ws();
+            if (eat_word("true"))  { out = true;  return true; }
+            if (eat_word("false")) { out = false; return true; }
+            return false;
+        }
+        // A plain unsigned integer no larger than `max` (no sign, fraction,
+        // exponent or leading zero, none of which JSON or the firmware use).
+        bool unsigned_int(std::uint64_t& out, std::uint64_t max) {
+            skip_ws();
+            const char* first = in.data() + pos;
+            const char* last = in.data() + in.size();
+            auto [end, ec] = std::from_chars(first, last, out);
+            if (ec != std::errc() || out > max) return false;
+            if (*first == '0' && end - first > 1) return false;
+            if (end < last && (*end == '.' || *end == 'e' || *end == 'E')) return false;
+            pos += static_cast<std::size_t>(end - first);
+            return true;
+        }
+    };
+}
+
+std::string_view room_from_topic(std::string_view topic) {
+    // naive split: "suction/OR 1/state"
+    auto first = topic.find('/');
+    if (first == std::string_view::npos) return {};
+    auto second = topic.find('/', first + 1);
+    if (second == std::string_view::npos) return {};
+    return topic.substr(first + 1, second - (first + 1)); // "OR 1"
+}
+
+bool parse_state_payload(std::string_view in, StatePayload& out) {
+    Cursor c{in};
+    bool has_suction = false;
+    out = StatePayload{};
+
+    if (!c.eat('{')) return false;
+    if (!c.eat('}')) {
+        do {
+            std::string_view k;
+            if (!c.key(k) || !c.eat(':')) return false;
+            if (k == "suction_on" && !has_suction) {
+                if (!c.boolean(out.suction_on)) return false;
+                has_suction = true;
+            } else if (k == "motion" && !out.has_motion) {
+                if (!c.boolean(out.motion)) return false;
+                out.has_motion = true;
+            } else if (k == "seq" && !out.has_seq) {
+                std::uint64_t v = 0;
+                if (!c.unsigned_int(v, std::numeric_limits<std::uint32_t>::max())) return false;
+                out.seq = static_cast<std::uint32_t>(v);
+                out.has_seq = true;
+            } else if (k == "ts" && !out.has_ts) {
+                if (!c.unsigned_int(out.ts, std::numeric_limits<std::uint64_t>::max())) return false;
+                out.has_ts = true;
+            } else {
+                return false;
+            }
+        } while (c.eat(','));
+        if (!c.eat('}')) return false;
+    }
+    c.skip_ws();
+    return has_suction && c.pos == in.size();
+}
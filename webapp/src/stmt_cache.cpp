@@ -0,0 +1,158 @@
+#include "stmt_cache.hpp"
+#include <crow.h>
+#include <iterator>
+
+namespace {
+    // Indexed by Stmt; keep in the same order as the enum.
+    constexpr const char* kSql[] = {
+        // CountRooms
+        "SELECT COUNT(*) FROM rooms",
+        // RoomIdByNumber
+        "SELECT id FROM rooms WHERE room_number = ? LIMIT 1",
+        // InsertRoom
+        "INSERT OR IGNORE INTO rooms (room_number) VALUES (?)",
+        // RoomStates: every room, its state and its windows for date ?1 and
+        // the day before, ?3 (for windows that run past midnight).
+        // The log is only consulted for rooms that have no suction_state row.
+        R"(
+        SELECT r.id, r.room_number,
+               COALESCE(ss.suction_on,
+                        (SELECT l.suction_on FROM suction_log l
+                         WHERE l.room_id = r.id ORDER BY l.id DESC LIMIT 1),
+                        0),
+               rs.id, rs.procedure, rs.start_time, rs.end_time, rs.date
+        FROM rooms r
+        LEFT JOIN suction_state ss ON ss.room_id = r.id
+        LEFT JOIN room_schedule rs ON rs.room_id = r.id AND rs.date IN (?1, ?3)
+        ORDER BY r.id, rs.start_time;
+        )",
+        // RoomStateById: as RoomStates, for room ?2 only
+        R"(
+        SELECT r.id, r.room_number,
+               COALESCE(ss.suction_on,
+                        (SELECT l.suction_on FROM suction_log l
+                         WHERE l.room_id = r.id ORDER BY l.id DESC LIMIT 1),
+                        0),
+               rs.id, rs.procedure, rs.start_time, rs.end_time, rs.date
+        FROM rooms r
+        LEFT JOIN suction_state ss ON ss.room_id = r.id
+        LEFT JOIN room_schedule rs ON rs.room_id = r.id AND rs.date IN (?1, ?3)
+        WHERE r.id = ?2
+        ORDER BY rs.start_time;
+        )",
+        // InsertSchedule
+        R"(
+        INSERT INTO room_schedule (room_id, procedure, start_time, end_time, date)
+        VALUES (?, ?, ?, ?, ?)
+        )",
+        // SuctionState
+        "SELECT suction_on, last_updated FROM suction_state WHERE room_id = ?",
+        // InsertSuctionLog
+        "INSERT INTO suction_log (room_id, timestamp, suction_on) VALUES (?, ?, ?)",
+        // UpsertSuctionState
+        R"(
+        INSERT INTO suction_state (room_id, suction_on, last_updated)
+        VALUES (?, ?, ?)
+        ON CONFLICT(room_id) DO UPDATE SET
+            suction_on=excluded.suction_on,
+            last_updated=excluded.last_updated;
+        )",
+        // RoomIds
+        "SELECT id FROM rooms ORDER BY id",
+        // RollupState
+        "SELECT rolled_until, suction_on FROM suction_rollup_state WHERE room_id = ?",
+        // FirstLogTimestamp
+        "SELECT MIN(timestamp) FROM suction_log WHERE room_id = ?",
+        // LogRange: a room's transitions in [?2, ?3)
+        R"(
+        SELECT timestamp, suction_on FROM suction_log
+        WHERE room_id = ?1 AND timestamp >= ?2 AND timestamp < ?3
+        ORDER BY timestamp, id
+        )",
+        // UpsertHourly
+        R"(
+        INSERT INTO suction_hourly (room_id, hour, on_seconds, transitions)
+        VALUES (?, ?, ?, ?)
+        ON CONFLICT(room_id, hour) DO UPDATE SET
+            on_seconds=on_seconds + excluded.on_seconds,
+            transitions=transitions + excluded.transitions;
+        )",
+        // UpsertRollupState
+        R"(
+        INSERT INTO suction_rollup_state (room_id, rolled_until, suction_on)
+        VALUES (?, ?, ?)
+        ON CONFLICT(room_id) DO UPDATE SET
+            rolled_until=excluded.rolled_until,
+            suction_on=excluded.suction_on;
+        )",
+        // HourlyRange: a room's rolled-up hours in [?2, ?3)
+        R"(
+        SELECT hour, on_seconds, transitions FROM suction_hourly
+        WHERE room_id = ?1 AND hour >= ?2 AND hour < ?3
+        ORDER BY hour
+        )",
+        // PruneSuctionLog: up to ?2 rows older than ?1 that are already rolled up
+        R"(
+        DELETE FROM suction_log WHERE id IN (
+            SELECT l.id FROM suction_rollup_state r
+            JOIN suction_log l ON l.room_id = r.room_id
+            WHERE l.timestamp < ?1 AND l.timestamp < r.rolled_until
+            LIMIT ?2)
+        )",
+        // LogPage: up to ?5 of a room's transitions after cursor (?2, ?3), before ?4
+        R"(
+        SELECT id, suction_on, timestamp FROM suction_log
+        WHERE room_id = ?1 AND (timestamp, id) > (?2, ?3) AND timestamp < ?4
+        ORDER BY timestamp, id
+        LIMIT ?5
+        )",
+        // Begin
+        "BEGIN IMMEDIATE",
+        // Commit
+        "COMMIT",
+        // Rollback
+        "ROLLBACK",
+    };
+    static_assert(std::size(kSql) == static_cast<std::size_t>(Stmt::Count_),
+                  "kSql must have one entry per Stmt");
+
+    // Indexed by Stmt, likewise.
+    constexpr const char* kNames[] = {
+        "CountRooms", "RoomIdByNumber", "InsertRoom", "RoomStates", "RoomStateById",
+        "InsertSchedule", "SuctionState", "InsertSuctionLog", "UpsertSuctionState", "RoomIds",
+        "RollupState", "FirstLogTimestamp", "LogRange", "UpsertHourly", "UpsertRollupState",
+        "HourlyRange", "PruneSuctionLog", "LogPage", "Begin", "Commit", "Rollback",
+    };
+    static_assert(std::size(kNames) == static_cast<std::size_t>(Stmt::Count_),
+                  "kNames must have one entry per Stmt");
+}
+
+const char* stmt_name(Stmt id) {
+    return kNames[static_cast<std::size_t>(id)];
+}
+
+StmtCache::StmtCache(sqlite3* db) : db_(db) {
+    for (std::size_t i = 0; i < timers_.size(); ++i) {
+        timers_[i] = &metrics().histogram("suction_sqlite_statement_duration_seconds",
+                                          "Time a prepared statement is in use, from checkout to reset.",
+                                          {{"statement", kNames[i]}});
+    }
+}
+
+StmtCache::~StmtCache() {
+    for (auto* s : stmts_) {
+        if (s) sqlite3_finalize(s);
+    }
+}
+
+StmtCache::Handle StmtCache::get(Stmt id) {
+    auto& slot = stmts_[static_cast<std::size_t>(id)];
+    if (!slot && db_) {
+        const char* sql = kSql[static_cast<std::size_t>(id)];
+        if (sqlite3_prepare_v3(db_, sql, -1, SQLITE_PREPARE_PERSISTENT, &slot, nullptr) != SQLITE_OK) {
+            CROW_LOG_ERROR << "Prepare failed: " << sqlite3_errmsg(db_);
+            slot = nullptr;
+        }
+    }
+    return Handle(slot, timers_[static_cast<std::size_t>(id)]);
+}
@@ -1,20 +1,66 @@
 #include "util.hpp"
 #include <chrono>
+#include <cstdio>
 #include <ctime>
 #include <iomanip>
 #include <sstream>
 
-//helper to format timestamp for DB
-std::string format_timestamp() {
-    const auto now = std::chrono::system_clock::now();
-    const std::time_t tt = std::chrono::system_clock::to_time_t(now);
+std::tm local_now() {
+    return local_time(epoch_seconds());
+}
+
+std::tm local_time(std::int64_t unix_seconds) {
+    const std::time_t tt = static_cast<std::time_t>(unix_seconds);
     std::tm local_tm{};
 #if defined(_WIN32)
     localtime_s(&local_tm, &tt);
 #else
     localtime_r(&tt, &local_tm);
 #endif
+    return local_tm;
+}
+
+//helper to format timestamp for DB
+std::string format_timestamp() {
+    const std::tm local_tm = local_now();
     std::ostringstream oss;
     oss << std::put_time(&local_tm, "%Y-%m-%d %H:%M:%S");
     return oss.str();
 }
+
+std::int64_t epoch_seconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int date_key(const std::tm& tm) {
+    return (tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday;
+}
+
+int add_days(int key, int days) {
+    std::tm tm{};
+    tm.tm_year = key / 10000 - 1900;
+    tm.tm_mon = key / 100 % 100 - 1;
+    tm.tm_mday = key % 100 + days;
+    tm.tm_hour = 12; // clear of DST transitions
+    tm.tm_isdst = -1;
+    std::mktime(&tm);
+    return date_key(tm);
+}
+
+int parse_hhmm(const std::string& hhmm) {
+    if (hhmm.size() != 5 || hhmm[2] != ':') return -1;
+    for (int i : {0, 1, 3, 4}) {
+        if (hhmm[i] < '0' || hhmm[i] > '9') return -1;
+    }
+    const int h = (hhmm[0] - '0') * 10 + (hhmm[1] - '0');
+    const int m = (hhmm[3] - '0') * 10 + (hhmm[4] - '0');
+    if (h > 23 || m > 59) return -1;
+    return h * 60 + m;
+}
+
+std::string format_minutes(int minutes) {
+    char buf[8];
+    std::snprintf(buf, sizeof(buf), "%02d:%02d", (minutes / 60) % 24, minutes % 60);
+    return buf;
+}
@@ -1,67 +1,211 @@
 #include "views.hpp"
 #include "util.hpp"
-#include <sstream>
-#include <iostream>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
 
-std::string render_dashboard(const std::vector<OperatingRoom>& rooms) {
-    static const std::string css =
-R"(body{margin:0;font-family:'Inter',system-ui,-apple-system,BlinkMacSystemFont,'Segoe UI',sans-serif;background:#0f172a;color:#e2e8f0;}a{color:#38bdf8;}main{max-width:1200px;margin:0 auto;padding:3rem 1.5rem;}header{text-align:center;margin-bottom:3rem;}header .logo{display:inline-flex;align-items:center;gap:0.75rem;margin-bottom:1rem;}header .logo-symbol{height:2.75rem;width:2.75rem;border-radius:0.9rem;background:#38bdf8;display:flex;align-items:center;justify-content:center;font-size:1.35rem;font-weight:700;color:#0f172a;}header .logo-text{font-size:1.5rem;font-weight:600;color:#e2e8f0;}h1{font-size:clamp(2.5rem,5vw,3.5rem);margin:0;color:#38bdf8;}p.subtitle{margin-top:0.5rem;color:#94a3b8;}section.cards{display:grid;grid-template-columns:repeat(auto-fit,minmax(260px,1fr));gap:1.5rem;}article.room-card{padding:1.5rem;border-radius:1.25rem;position:relative;overflow:hidden;box-shadow:0 15px 35px rgba(15,23,42,0.25);transition:transform 0.2s ease, box-shadow 0.2s ease;border:1px solid rgba(148,163,184,0.15);}article.room-card:hover{transform:translateY(-6px);box-shadow:0 20px 45px rgba(15,23,42,0.35);}article.room-card.room-card--ok{background:linear-gradient(135deg,rgba(22,163,74,0.95),rgba(21,128,61,0.9));color:#dcfce7;border-color:rgba(134,239,172,0.5);}article.room-card.room-card--warn{background:linear-gradient(135deg,rgba(234,179,8,0.95),rgba(202,138,4,0.9));color:#1f2937;border-color:rgba(234,179,8,0.55);}article.room-card .card-header{display:flex;align-items:center;justify-content:space-between;margin-bottom:0.5rem;}article.room-card h3{font-size:2rem;margin:0;font-weight:800;}article.room-card .meta{margin-top:0.25rem;font-weight:600;opacity:0.9;}article.room-card .time{font-size:0.85rem;opacity:0.8;}article.room-card .status{margin-top:1rem;font-size:1rem;font-weight:700;display:flex;align-items:center;gap:0.5rem;}article.room-card .status .icon{font-size:1.4rem;}article.room-card .status-icon{font-size:1.5rem;}footer{text-align:center;margin-top:3rem;color:#64748b;font-size:0.85rem;}footer span{font-weight:600;color:#38bdf8;}@media (prefers-color-scheme: light){body{background:#f8fafc;color:#0f172a;}article.room-card{box-shadow:0 10px 25px rgba(15,23,42,0.12);}})";
+namespace {
 
-    std::ostringstream cards;
-    for (const auto& room : rooms) {
-        const bool suctionon = room.suction_on;
-        const bool ok = (suctionon && room.procedure != "Idle / Unscheduled") ||  (!suctionon && room.procedure == "Idle / Unscheduled");
-        cards << "<article class='room-card " << (ok ? "room-card--ok" : "room-card--warn")
-              << "' data-room-id='" << room.id << "'>";
-        cards << "<div class='card-header'>";
-        cards << "<h3>" << room.room_number << "</h3>";
-        if (!ok) { cards << "<div class='status-icon' aria-hidden='true'>⚠️</div>"; }
-        cards << "</div>";
-        cards << "<p class='meta'>" << room.procedure << "</p>";
-        cards << "<p class='time'>" << room.schedule << "</p>";
-        cards << "<div class='status'>";
-        cards << "<span class='icon'>" << (suctionon ? "🟢" : "🔴") << "</span>";
-        cards << "Suction: " << (suctionon ? "ON" : "OFF");
-        cards << "</div></article>";
-    }
+const char* const kCss =
+R"(body{margin:0;font-family:'Inter',system-ui,-apple-system,BlinkMacSystemFont,'Segoe UI',sans-serif;background:#0f172a;color:#e2e8f0;}a{color:#38bdf8;}main{max-width:1200px;margin:0 auto;padding:3rem 1.5rem;}header{text-align:center;margin-bottom:3rem;}header .logo{display:inline-flex;align-items:center;gap:0.75rem;margin-bottom:1rem;}header .logo-symbol{height:2.75rem;width:2.75rem;border-radius:0.9rem;background:#38bdf8;display:flex;align-items:center;justify-content:center;font-size:1.35rem;font-weight:700;color:#0f172a;}header .logo-text{font-size:1.5rem;font-weight:600;color:#e2e8f0;}h1{font-size:clamp(2.5rem,5vw,3.5rem);margin:0;color:#38bdf8;}p.subtitle{margin-top:0.5rem;color:#94a3b8;}section.cards{display:grid;grid-template-columns:repeat(auto-fit,minmax(260px,1fr));gap:1.5rem;}article.room-card{padding:1.5rem;border-radius:1.25rem;position:relative;overflow:hidden;box-shadow:0 15px 35px rgba(15,23,42,0.25);transition:transform 0.2s ease, box-shadow 0.2s ease;border:1px solid rgba(148,163,184,0.15);}article.room-card:hover{transform:translateY(-6px);box-shadow:0 20px 45px rgba(15,23,42,0.35);}article.room-card.room-card--ok{background:linear-gradient(135deg,rgba(22,163,74,0.95),rgba(21,128,61,0.9));color:#dcfce7;border-color:rgba(134,239,172,0.5);}article.room-card.room-card--warn{background:linear-gradient(135deg,rgba(234,179,8,0.95),rgba(202,138,4,0.9));color:#1f2937;border-color:rgba(234,179,8,0.55);}article.room-card .card-header{display:flex;align-items:center;justify-content:space-between;margin-bottom:0.5rem;}article.room-card h3{font-size:2rem;margin:0;font-weight:800;}article.room-card .meta{margin-top:0.25rem;font-weight:600;opacity:0.9;}article.room-card .time{font-size:0.85rem;opacity:0.8;}article.room-card .status{margin-top:1rem;font-size:1rem;font-weight:700;display:flex;align-items:center;gap:0.5rem;}article.room-card .status .icon{font-size:1.4rem;}article.room-card .status-icon{font-size:1.5rem;}article.room-card.room-card--stale{filter:grayscale(0.85);opacity:0.75;}article.room-card .liveness{margin-top:0.5rem;font-size:0.85rem;font-weight:700;}footer{text-align:center;margin-top:3rem;color:#64748b;font-size:0.85rem;}footer span{font-weight:600;color:#38bdf8;}@media (prefers-color-scheme: light){body{background:#f8fafc;color:#0f172a;}article.room-card{box-shadow:0 10px 25px rgba(15,23,42,0.12);}})";
 
-    std::ostringstream page;
-    page << "<!DOCTYPE html><html lang='en'><head><meta charset='utf-8'/>"
-         << "<meta name='viewport' content='width=device-width,initial-scale=1'/>"
-         << "<title>SuctionSense Dashboard</title>"
-         << "<link rel='preconnect' href='https://fonts.googleapis.com'>"
-         << "<link rel='preconnect' href='https://fonts.gstatic.com' crossorigin>"
-         << "<link href='https://fonts.googleapis.com/css2?family=Inter:wght@400;500;600;700;800&display=swap' rel='stylesheet'>"
-         << "<style>" << css << "</style></head><body><main>";
-    page << "<header><div class='logo'><div class='logo-symbol'>S</div>"
-         << "<span class='logo-text'>SuctionSense</span></div>"
-         << "<h1>Operating Room Suction Status</h1>"
-         << "<p class='subtitle'>Real-time monitoring dashboard</p></header>";
-    page << "<section class='cards'>" << cards.str() << "</section>";
-    page << "<footer><p>Last updated: <span id='last-updated'>" << format_timestamp() << "</span></p></footer>";
-    page << "</main>";
-
-    page << R"(<script>
+const char* const kJs =
+R"(function applyRoom(room) {
+  const card = document.querySelector(`[data-room-id='${room.id}']`);
+  if (!card) return;
+  const status = card.querySelector('.status');
+  const cardClass = (room.suctionOn && room.procedure != "Idle / Unscheduled") ||  (!room.suctionOn && room.procedure == "Idle / Unscheduled") ? 'room-card--ok' : 'room-card--warn';
+  card.classList.remove('room-card--ok','room-card--warn');
+  card.classList.add(cardClass);
+  card.querySelector('.meta').textContent = room.procedure;
+  card.querySelector('.time').textContent = room.schedule;
+  status.innerHTML = `<span class='icon'>${room.suctionOn ? '🟢' : '🔴'}</span> Suction: ${room.suctionOn ? 'ON' : 'OFF'}`;
+  card.classList.toggle('room-card--stale', room.stale);
+  card.querySelector('.liveness').hidden = !room.stale;
+}
+function applyRooms(data) {
+  document.getElementById('last-updated').textContent = data.generatedAt;
+  data.rooms.forEach(applyRoom);
+}
+// Polls ask only for what changed since the last answer (the first one gets every room).
+let since = { epoch: 0, version: 0, minute: 0 };
 async function fetchData() {
   try {
-    const res = await fetch('/api/rooms');
+    const res = await fetch(`/api/rooms/changes?epoch=${since.epoch}&since=${since.version}&minute=${since.minute}`, { cache: 'no-store' });
+    if (!res.ok) throw new Error(`HTTP ${res.status}`);
     const data = await res.json();
-    const rooms = data.rooms;
-    document.getElementById('last-updated').textContent = data.generatedAt;
-    rooms.forEach(room => {
-      const card = document.querySelector(`[data-room-id='${room.id}']`);
-      if (!card) return;
-      const status = card.querySelector('.status');
-      const cardClass = (room.suctionOn && room.procedure != "Idle / Unscheduled") ||  (!room.suctionOn && room.procedure == "Idle / Unscheduled") ? 'room-card--ok' : 'room-card--warn';
-      card.classList.remove('room-card--ok','room-card--warn');
-      card.classList.add(cardClass);
-      status.innerHTML = `<span class='icon'>${room.suctionOn ? '🟢' : '🔴'}</span> Suction: ${room.suctionOn ? 'ON' : 'OFF'}`;
-    });
+    applyRooms(data);
+    since = { epoch: data.epoch, version: data.version, minute: data.minute };
   } catch (e) { console.error('update error', e); }
 }
-setInterval(fetchData, 5000);
-</script>)";
+// Updates are pushed over /api/rooms/stream; poll every 5 s only while it is down.
+let pollTimer = null;
+function startPolling() {
+  if (pollTimer) return;
+  fetchData();
+  pollTimer = setInterval(fetchData, 5000);
+}
+function stopPolling() {
+  clearInterval(pollTimer);
+  pollTimer = null;
+}
+function connect(delay) {
+  if (!('WebSocket' in window)) { startPolling(); return; }
+  const ws = new WebSocket((location.protocol === 'https:' ? 'wss://' : 'ws://') + location.host + '/api/rooms/stream');
+  ws.onopen = () => { stopPolling(); delay = 1000; };
+  ws.onmessage = ev => {
+    try { applyRooms(JSON.parse(ev.data)); } catch (e) { console.error('stream error', e); }
+  };
+  ws.onclose = () => {
+    startPolling();
+    setTimeout(() => connect(Math.min(delay * 2, 30000)), delay);
+  };
+}
+connect(1000);
+)";
+
+// FNV-1a (64-bit); enough to tell asset versions apart in a URL.
+std::uint64_t fnv1a(std::string_view s) {
+    std::uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+StaticAsset make_asset(const char* stem, const char* ext, const char* content_type, std::string body) {
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(fnv1a(body)));
+
+    StaticAsset a;
+    a.path = std::string("/assets/") + stem + "." + hash + "." + ext;
+    a.content_type = content_type;
+    a.etag = std::string("\"") + hash + "\"";
+    // Compressed once, so spend the time on the best ratio.
+    a.gzip = gzip_compress(body, 9);
+    if (a.gzip.size() >= body.size()) a.gzip.clear();
+    a.brotli = brotli_compress(body, 11);
+    if (a.brotli.size() >= body.size()) a.brotli.clear();
+    a.body = std::move(body);
+    return a;
+}
+
+struct Assets {
+    StaticAsset css = make_asset("dashboard", "css", "text/css; charset=UTF-8", kCss);
+    StaticAsset js  = make_asset("dashboard", "js", "text/javascript; charset=UTF-8", kJs);
+};
+
+const Assets& assets() {
+    static const Assets a;
+    return a;
+}
+
+// The page split around its two dynamic parts: cards go between head and
+// middle, the timestamp between middle and tail.
+struct DashboardTemplate {
+    std::string head;
+    std::string middle;
+    std::string tail;
+};
+
+const DashboardTemplate& dashboard_template() {
+    static const DashboardTemplate t = [] {
+        const Assets& a = assets();
+        DashboardTemplate t;
+        t.head = "<!DOCTYPE html><html lang='en'><head><meta charset='utf-8'/>"
+                 "<meta name='viewport' content='width=device-width,initial-scale=1'/>"
+                 "<title>SuctionSense Dashboard</title>"
+                 "<link rel='stylesheet' href='" + a.css.path + "'>"
+                 "<script src='" + a.js.path + "' defer></script>"
+                 "</head><body><main>"
+                 "<header><div class='logo'><div class='logo-symbol'>S</div>"
+                 "<span class='logo-text'>SuctionSense</span></div>"
+                 "<h1>Operating Room Suction Status</h1>"
+                 "<p class='subtitle'>Real-time monitoring dashboard</p></header>"
+                 "<section class='cards'>";
+        t.middle = "</section><footer><p>Last updated: <span id='last-updated'>";
+        t.tail = "</span></p></footer></main></body></html>";
+        return t;
+    }();
+    return t;
+}
+
+// Rough size of one card's markup besides its strings, for reserve().
+constexpr std::size_t kCardMarkup = 400;
+
+// Room numbers come from MQTT topics and API clients, so card text is escaped.
+void append_html(std::string& out, std::string_view text) {
+    for (char c : text) {
+        switch (c) {
+            case '<':  out += "&lt;"; break;
+            case '>':  out += "&gt;"; break;
+            case '&':  out += "&amp;"; break;
+            case '\'': out += "&#39;"; break;
+            case '"':  out += "&quot;"; break;
+            default:   out += c;
+        }
+    }
+}
+
+void append_card(std::string& out, const OperatingRoom& room) {
+    const bool suctionon = room.suction_on;
+    const bool ok = (suctionon && room.procedure != "Idle / Unscheduled") ||  (!suctionon && room.procedure == "Idle / Unscheduled");
+
+    char id[16];
+    const auto [id_end, ec] = std::to_chars(id, id + sizeof(id), room.id);
+    (void)ec;
+
+    out += "<article class='room-card ";
+    out += ok ? "room-card--ok" : "room-card--warn";
+    if (room.stale) out += " room-card--stale";
+    out += "' data-room-id='";
+    out.append(id, id_end);
+    out += "'><div class='card-header'><h3>";
+    append_html(out, room.room_number);
+    out += "</h3>";
+    if (!ok) out += "<div class='status-icon' aria-hidden='true'>⚠️</div>";
+    out += "</div><p class='meta'>";
+    append_html(out, room.procedure);
+    out += "</p><p class='time'>";
+    append_html(out, room.schedule);
+    out += "</p><div class='status'><span class='icon'>";
+    out += suctionon ? "🟢</span>Suction: ON" : "🔴</span>Suction: OFF";
+    out += "</div><p class='liveness'";
+    if (!room.stale) out += " hidden";
+    out += ">📡 Sensor offline – last known state</p></article>";
+}
+
+} // namespace
+
+const std::string& StaticAsset::encoded(Encoding& e) const {
+    if (e == Encoding::Brotli && !brotli.empty()) return brotli;
+    if (e == Encoding::Gzip && !gzip.empty()) return gzip;
+    e = Encoding::Identity;
+    return body;
+}
+
+const StaticAsset* find_asset(std::string_view path) {
+    const Assets& a = assets();
+    if (path == a.css.path) return &a.css;
+    if (path == a.js.path) return &a.js;
+    return nullptr;
+}
+
+std::string render_dashboard(const std::vector<OperatingRoom>& rooms) {
+    const DashboardTemplate& t = dashboard_template();
+
+    std::size_t size = t.head.size() + t.middle.size() + t.tail.size() + 32;
+    for (const auto& room : rooms) {
+        size += kCardMarkup + room.room_number.size() + room.procedure.size() + room.schedule.size();
+    }
+    std::string page;
+    page.reserve(size);
 
-    page << "</body></html>";
-    return page.str();
+    page += t.head;
+    for (const auto& room : rooms) append_card(page, room);
+    page += t.middle;
+    page += format_timestamp();
+    page += t.tail;
+    return page;
 }
@@ -0,0 +1,24 @@
+// tests/check.hpp
+#pragma once
+#include <cstdio>
+
+// Minimal assertions for the checks in tests/: each failure is printed and
+// check_result() turns them into the exit code CTest looks at.
+inline int& check_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                                   \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++check_failures();                                                       \
+        }                                                                             \
+    } while (0)
+
+inline int check_result() {
+    if (check_failures() == 0) return 0;
+    std::fprintf(stderr, "%d check(s) failed\n", check_failures());
+    return 1;
+}
@@ -0,0 +1,27 @@
+// tests/compress_test.cpp
+// negotiate_encoding() on Accept-Encoding values browsers and proxies send,
+// including refusals next to a wildcard.
+#include "compress.hpp"
+#include "check.hpp"
+
+int main() {
+#ifdef SUCTION_HAVE_BROTLI
+    const Encoding best = Encoding::Brotli;
+#else
+    const Encoding best = Encoding::Gzip;
+#endif
+    CHECK(negotiate_encoding("") == Encoding::Identity);
+    CHECK(negotiate_encoding("identity") == Encoding::Identity);
+    CHECK(negotiate_encoding("gzip, deflate") == Encoding::Gzip);
+    CHECK(negotiate_encoding("gzip, deflate, br") == best);
+    CHECK(negotiate_encoding("*") == best);
+    CHECK(negotiate_encoding("*;q=0") == Encoding::Identity);
+    CHECK(negotiate_encoding("gzip;q=0, deflate") == Encoding::Identity);
+
+    // "*" must not bring back a coding the client refused by name.
+    CHECK(negotiate_encoding("br;q=0, *") == Encoding::Gzip);
+    CHECK(negotiate_encoding("*, br;q=0") == Encoding::Gzip);
+    CHECK(negotiate_encoding("gzip;q=0, br;q=0, *") == Encoding::Identity);
+    CHECK(negotiate_encoding("gzip;q=0.5, br;q=0, *;q=0") == Encoding::Gzip);
+    return check_result();
+}
@@ -0,0 +1,186 @@
+// tests/mqtt_ingestor_test.cpp
+// MqttIngestor end to end against an in-process stand-in for libmosquitto:
+// messages are handed straight to the client's callbacks, and the checks
+// look at what reached the Repo.
+#include "mqtt_ingestor.hpp"
+#include "repo.hpp"
+#include "util.hpp"
+#include "check.hpp"
+#include <mosquitto.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+// -------- fake broker --------
+// Defines the libmosquitto calls MqttIngestor makes; being in the executable,
+// they take precedence over the shared library's.
+
+struct mosquitto {
+    void* obj = nullptr;
+    void (*on_connect)(struct mosquitto*, void*, int) = nullptr;
+    void (*on_message)(struct mosquitto*, void*, const struct mosquitto_message*) = nullptr;
+    std::vector<std::string> filters;
+    std::atomic<bool> subscribed{false};
+    std::atomic<bool> stop{false};
+};
+
+namespace {
+    std::mutex clients_mtx;
+    std::vector<mosquitto*> clients; // guarded by clients_mtx
+}
+
+extern "C" {
+int mosquitto_lib_init(void) { return MOSQ_ERR_SUCCESS; }
+int mosquitto_lib_cleanup(void) { return MOSQ_ERR_SUCCESS; }
+
+struct mosquitto* mosquitto_new(const char* /*id*/, bool /*clean_session*/, void* obj) {
+    auto* m = new mosquitto;
+    m->obj = obj;
+    std::lock_guard<std::mutex> lk(clients_mtx);
+    clients.push_back(m);
+    return m;
+}
+
+void mosquitto_destroy(struct mosquitto* m) {
+    {
+        std::lock_guard<std::mutex> lk(clients_mtx);
+        clients.erase(std::remove(clients.begin(), clients.end(), m), clients.end());
+    }
+    delete m;
+}
+
+void mosquitto_connect_callback_set(struct mosquitto* m, void (*f)(struct mosquitto*, void*, int)) { m->on_connect = f; }
+void mosquitto_disconnect_callback_set(struct mosquitto*, void (*)(struct mosquitto*, void*, int)) {}
+void mosquitto_message_callback_set(struct mosquitto* m,
+                                    void (*f)(struct mosquitto*, void*, const struct mosquitto_message*)) {
+    m->on_message = f;
+}
+int mosquitto_reconnect_delay_set(struct mosquitto*, unsigned int, unsigned int, bool) { return MOSQ_ERR_SUCCESS; }
+int mosquitto_connect(struct mosquitto*, const char*, int, int) { return MOSQ_ERR_SUCCESS; }
+int mosquitto_disconnect(struct mosquitto* m) {
+    m->stop = true;
+    return MOSQ_ERR_SUCCESS;
+}
+
+int mosquitto_subscribe(struct mosquitto* m, int*, const char* filter, int) {
+    m->filters.emplace_back(filter);
+    return MOSQ_ERR_SUCCESS;
+}
+
+int mosquitto_loop_forever(struct mosquitto* m, int, int) {
+    m->on_connect(m, m->obj, 0);
+    m->subscribed = true;
+    while (!m->stop) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return MOSQ_ERR_SUCCESS;
+}
+}
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const char* kDbPath = "mqtt_ingestor_test.db";
+
+    void remove_db() {
+        unlink(kDbPath);
+        unlink("mqtt_ingestor_test.db-wal");
+        unlink("mqtt_ingestor_test.db-shm");
+    }
+
+    // Delivers one message to the (single, unshared) client, as the broker would.
+    void publish(const std::string& topic, const std::string& payload, bool retained = false) {
+        std::lock_guard<std::mutex> lk(clients_mtx);
+        mosquitto* m = clients.front();
+        mosquitto_message msg{};
+        std::string t = topic;
+        std::string p = payload;
+        msg.topic = t.data();
+        msg.payload = p.data();
+        msg.payloadlen = static_cast<int>(p.size());
+        msg.qos = 1;
+        msg.retain = retained;
+        m->on_message(m, m->obj, &msg);
+    }
+
+    bool wait_for(const std::function<bool()>& done) {
+        const auto deadline = Clock::now() + std::chrono::seconds(5);
+        while (!done()) {
+            if (Clock::now() > deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    std::vector<std::string> room_numbers(Repo& repo) {
+        std::vector<std::string> out;
+        for (const auto& r : repo.load_rooms()) out.push_back(r.room_number);
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+}
+
+int main() {
+    remove_db();
+    {
+        Repo repo(kDbPath);
+        IngestOptions options;
+        options.coalesce_window = std::chrono::milliseconds(0);
+        MqttIngestor ingestor(repo, "localhost", 1883, "suction/+/state", 1, options);
+        CHECK(ingestor.start());
+        CHECK(wait_for([] {
+            std::lock_guard<std::mutex> lk(clients_mtx);
+            return clients.size() == 1 && clients.front()->subscribed;
+        }));
+
+        // Status (retained, LWT or live) from a device that never reported
+        // state leaves the room list alone.
+        publish("suction/ghost/status", R"({"status":"online"})", true);
+        publish("suction/ghost/status", R"({"status":"offline"})");
+        // A shard drains in order, so once OR-1 shows up the statuses are done.
+        publish("suction/OR-1/state", R"({"suction_on":true})");
+        CHECK(wait_for([&] { return repo.find_room_id("OR-1") > 0; }));
+        CHECK(wait_for([&] { return ingestor.stats().processed == 3; }));
+        CHECK(room_numbers(repo) == std::vector<std::string>{"OR-1"});
+        CHECK(repo.find_room_id("ghost") == 0);
+
+        // A known room's status still counts.
+        publish("suction/OR-1/status", R"({"status":"offline"})");
+        CHECK(wait_for([&] {
+            const auto rooms = repo.load_rooms();
+            return rooms.size() == 1 && rooms.front().stale;
+        }));
+
+        // Room names up to kMaxRoomName bytes are queued; longer ones are not.
+        const std::string longest(kMaxRoomName, 'L');
+        publish("suction/" + longest + "/state", R"({"suction_on":true})");
+        publish("suction/" + longest + "X/state", R"({"suction_on":true})");
+        CHECK(wait_for([&] { return repo.find_room_id(longest) > 0; }));
+        CHECK(repo.find_room_id(longest + "X") == 0);
+
+        // A live repeat of the current state writes nothing, but a backfill
+        // stamped before it must not overturn it.
+        const int or2 = repo.ensure_room_id("OR-2");
+        const std::int64_t now = epoch_seconds();
+        CHECK(repo.update_suction_batch({{or2, true, now - 100}})[0] == SuctionUpdateStatus::Applied);
+        const auto duplicates = ingestor.stats().duplicates;
+        publish("suction/OR-2/state", R"({"suction_on":true})");
+        CHECK(wait_for([&] { return ingestor.stats().duplicates == duplicates + 1; }));
+        CHECK(repo.update_suction_batch({{or2, false, now - 50}})[0] == SuctionUpdateStatus::OutOfOrder);
+        CHECK(repo.suction_state(or2) == true);
+        // A retained replay proves nothing about now.
+        const int or3 = repo.ensure_room_id("OR-3");
+        CHECK(repo.update_suction_batch({{or3, true, now - 100}})[0] == SuctionUpdateStatus::Applied);
+        publish("suction/OR-3/state", R"({"suction_on":true})", true);
+        CHECK(wait_for([&] { return ingestor.stats().duplicates == duplicates + 2; }));
+        CHECK(repo.update_suction_batch({{or3, false, now - 50}})[0] == SuctionUpdateStatus::Applied);
+
+        ingestor.stop();
+    }
+    remove_db();
+    return check_result();
+}
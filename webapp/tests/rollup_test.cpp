@@ -0,0 +1,141 @@
+// tests/rollup_test.cpp
+// Hourly usage, rolled up or folded live from suction_log, against a
+// second-by-second replay of the same updates.
+#include "repo.hpp"
+#include "util.hpp"
+#include "check.hpp"
+#include <algorithm>
+#include <map>
+#include <random>
+#include <unistd.h>
+
+namespace {
+    constexpr std::int64_t kHour = 3600;
+    const char* kDbPath = "rollup_test.db";
+
+    void remove_db() {
+        unlink(kDbPath);
+        unlink("rollup_test.db-wal");
+        unlink("rollup_test.db-shm");
+    }
+
+    std::int64_t hour_floor(std::int64_t t) { return t - t % kHour; }
+
+    struct Row {
+        std::int64_t ts;
+        bool on;
+    };
+
+    // What suction_log should hold: every applied update that changed the
+    // room's state, and its first one.
+    struct Model {
+        std::map<int, std::vector<Row>> log;
+        std::map<int, bool> state;
+
+        void apply(int room, std::int64_t ts, bool on) {
+            auto it = state.find(room);
+            if (it == state.end() || it->second != on) log[room].push_back({ts, on});
+            state[room] = on;
+        }
+
+        // On-seconds and transitions per hour for [first hour, until).
+        std::map<std::int64_t, HourlyUsage> usage(int room, std::int64_t until) const {
+            std::map<std::int64_t, HourlyUsage> out;
+            const auto it = log.find(room);
+            if (it == log.end()) return out;
+            const auto& rows = it->second;
+            std::size_t next = 0;
+            bool on = false;
+            for (std::int64_t t = hour_floor(rows.front().ts); t < until; ++t) {
+                while (next < rows.size() && rows[next].ts == t) {
+                    auto& h = out.try_emplace(hour_floor(t), HourlyUsage{hour_floor(t), 0, 0}).first->second;
+                    ++h.transitions;
+                    on = rows[next++].on;
+                }
+                if (on) {
+                    out.try_emplace(hour_floor(t), HourlyUsage{hour_floor(t), 0, 0}).first->second.on_seconds++;
+                }
+            }
+            return out;
+        }
+    };
+
+    // Complete hours only: the current one still moves with the clock.
+    void check_usage(Repo& repo, const Model& model, const std::vector<int>& ids,
+                     std::int64_t from, std::int64_t until) {
+        for (int id : ids) {
+            const auto want = model.usage(id, until);
+            std::map<std::int64_t, HourlyUsage> got;
+            for (const auto& h : repo.hourly_usage(id, from, until)) {
+                if (h.on_seconds || h.transitions) got[h.hour] = h;
+            }
+            std::size_t expected = 0;
+            for (const auto& [hour, w] : want) {
+                if (hour < from || (!w.on_seconds && !w.transitions)) continue;
+                ++expected;
+                const auto g = got.find(hour);
+                CHECK(g != got.end());
+                if (g == got.end()) continue;
+                CHECK(g->second.on_seconds == w.on_seconds);
+                CHECK(g->second.transitions == w.transitions);
+            }
+            CHECK(got.size() == expected);
+        }
+    }
+}
+
+int main() {
+    remove_db();
+    {
+        Repo repo(kDbPath);
+        std::vector<int> ids;
+        for (int i = 0; i < 4; ++i) ids.push_back(repo.ensure_room_id("RU-" + std::to_string(i)));
+
+        // 30 hours of updates ending an hour before now, sent in time order.
+        const std::int64_t now = epoch_seconds();
+        const std::int64_t end = hour_floor(now) - kHour;
+        const std::int64_t start = end - 30 * kHour;
+        std::mt19937 rng(7);
+        std::vector<SuctionUpdate> updates;
+        for (int i = 0; i < 2000; ++i) {
+            const std::int64_t ts = start + static_cast<std::int64_t>(rng() % static_cast<std::uint32_t>(end - start));
+            updates.push_back({ids[rng() % ids.size()], rng() % 3 != 0, ts});
+        }
+        std::sort(updates.begin(), updates.end(),
+                  [](const SuctionUpdate& a, const SuctionUpdate& b) { return a.timestamp < b.timestamp; });
+
+        Model model;
+        const std::size_t chunk = 100;
+        for (std::size_t i = 0; i < updates.size(); i += chunk) {
+            const std::vector<SuctionUpdate> batch(updates.begin() + static_cast<std::ptrdiff_t>(i),
+                                                   updates.begin() + static_cast<std::ptrdiff_t>(std::min(i + chunk, updates.size())));
+            const auto status = repo.update_suction_batch(batch);
+            for (std::size_t k = 0; k < batch.size(); ++k) {
+                CHECK(status[k] == SuctionUpdateStatus::Applied);
+                if (status[k] == SuctionUpdateStatus::Applied) model.apply(batch[k].room_id, batch[k].timestamp, batch[k].suction_on);
+            }
+            // Roll up part of the way now and then, as LogMaintenance would.
+            if (i % 700 == 0 && i + chunk < updates.size()) repo.rollup_hourly(updates[i + chunk].timestamp);
+        }
+
+        // Live fold, then after a full rollup: both must match the replay.
+        check_usage(repo, model, ids, start, end);
+        CHECK(repo.rollup_hourly(end) > 0);
+        check_usage(repo, model, ids, start, end);
+
+        // Folded hours refuse late updates instead of silently missing them.
+        const auto late = repo.update_suction_batch({{ids[0], !model.state[ids[0]], end - 10}});
+        CHECK(late[0] == SuctionUpdateStatus::RolledUp);
+
+        // Live updates never land behind a watermark, even one ahead of the
+        // clock (as after the clock steps back).
+        repo.rollup_hourly(now + kHour);
+        repo.update_suction(ids[1], !model.state[ids[1]]);
+        repo.flush();
+        const auto last = repo.suction_history(ids[1], 0, now + 3 * kHour, 0, 0, 1000);
+        CHECK(!last.empty() && last.back().timestamp >= hour_floor(now + kHour));
+        check_usage(repo, model, ids, start, end);
+    }
+    remove_db();
+    return check_result();
+}
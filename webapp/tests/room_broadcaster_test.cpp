@@ -0,0 +1,166 @@
+// tests/room_broadcaster_test.cpp
+// RoomBroadcaster fan-out to 1000 in-process subscribers while rooms flip and
+// subscribers come and go: every subscriber gets the same messages in the
+// same order, replays them to the Repo's state, and hears nothing once
+// unsubscribe() has returned.
+#include "repo.hpp"
+#include "room_broadcaster.hpp"
+#include "check.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const char* kDbPath = "room_broadcaster_test.db";
+
+    void remove_db() {
+        unlink(kDbPath);
+        unlink("room_broadcaster_test.db-wal");
+        unlink("room_broadcaster_test.db-shm");
+    }
+
+    // What a dashboard would make of its messages.
+    struct Subscriber {
+        std::mutex mtx;
+        std::map<int, bool> view;
+        std::vector<std::size_t> hashes; // every message but its generatedAt, in order
+        bool first_was_full = false;
+        std::atomic<bool> in_send{false};
+        std::atomic<bool> overlapped{false};
+        std::atomic<bool> gone{false};    // unsubscribe() has returned
+        std::atomic<bool> after_gone{false};
+
+        void receive(const std::string& msg) {
+            if (in_send.exchange(true)) overlapped = true;
+            if (gone) after_gone = true;
+            auto j = nlohmann::json::parse(msg);
+            // Stamped to the second when rendered, so subscribers that join
+            // either side of a second boundary would otherwise differ.
+            j.erase("generatedAt");
+            {
+                std::lock_guard<std::mutex> lk(mtx);
+                if (hashes.empty()) first_was_full = j.value("type", "") == "rooms";
+                if (j.value("type", "") == "rooms") view.clear();
+                for (const auto& room : j["rooms"]) view[room["id"].get<int>()] = room["suctionOn"].get<bool>();
+                hashes.push_back(std::hash<std::string>{}(j.dump()));
+            }
+            in_send = false;
+        }
+    };
+
+    std::map<int, bool> repo_view(Repo& repo) {
+        std::map<int, bool> out;
+        for (const auto& r : repo.load_rooms()) out[r.id] = r.suction_on;
+        return out;
+    }
+
+    void subscribe(RoomBroadcaster& broadcaster, Subscriber& s) {
+        broadcaster.subscribe(&s, [&s](const std::string& msg) { s.receive(msg); });
+    }
+}
+
+int main() {
+    constexpr int kSubscribers = 1000;
+    constexpr int kRooms = 40;
+    constexpr int kBursts = 100;
+
+    remove_db();
+    {
+        Repo repo(kDbPath);
+        std::vector<int> ids;
+        for (int i = 0; i < kRooms; ++i) ids.push_back(repo.ensure_room_id("BC-" + std::to_string(i)));
+
+        RoomBroadcaster broadcaster(repo);
+        broadcaster.start();
+
+        std::vector<std::unique_ptr<Subscriber>> subs;
+        for (int i = 0; i < kSubscribers; ++i) {
+            subs.push_back(std::make_unique<Subscriber>());
+            subscribe(broadcaster, *subs.back());
+        }
+        CHECK(broadcaster.subscribers() == static_cast<std::size_t>(kSubscribers));
+
+        // Churn alongside the writes: the last 100 leave one by one, and as
+        // many late ones join.
+        std::vector<std::unique_ptr<Subscriber>> late;
+        for (int i = 0; i < 100; ++i) late.push_back(std::make_unique<Subscriber>());
+        std::thread churn([&] {
+            for (int i = 0; i < 100; ++i) {
+                Subscriber& leaving = *subs[static_cast<std::size_t>(kSubscribers - 1 - i)];
+                broadcaster.unsubscribe(&leaving);
+                leaving.gone = true;
+                subscribe(broadcaster, *late[static_cast<std::size_t>(i)]);
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+
+        std::mt19937 rng(19);
+        for (int b = 0; b < kBursts; ++b) {
+            for (int k = 0; k < 5; ++k) {
+                const int id = ids[rng() % ids.size()];
+                repo.update_suction(id, !repo.suction_state(id).value_or(false));
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+        churn.join();
+
+        // Wait for the last delta to reach everyone still subscribed.
+        const auto truth = repo_view(repo);
+        const auto deadline = Clock::now() + std::chrono::seconds(10);
+        auto settled = [&] {
+            for (std::size_t i = 0; i + 100 < subs.size(); ++i) {
+                std::lock_guard<std::mutex> lk(subs[i]->mtx);
+                if (subs[i]->view != truth) return false;
+            }
+            for (auto& s : late) {
+                std::lock_guard<std::mutex> lk(s->mtx);
+                if (s->view != truth) return false;
+            }
+            return true;
+        };
+        while (!settled() && Clock::now() < deadline) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        broadcaster.stop();
+
+        CHECK(broadcaster.subscribers() == static_cast<std::size_t>(kSubscribers));
+        std::uint64_t delivered = 0;
+        for (auto* group : {&subs, &late}) {
+            for (auto& s : *group) {
+                delivered += s->hashes.size();
+                CHECK(s->first_was_full);
+                CHECK(!s->overlapped);
+                CHECK(!s->after_gone);
+            }
+        }
+        CHECK(broadcaster.messages_sent() == delivered);
+
+        // Everyone there from the start saw exactly the same stream, and it
+        // ends at the Repo's state; so did every late joiner.
+        const auto& reference = subs[0]->hashes;
+        CHECK(reference.size() > 1);
+        for (std::size_t i = 0; i + 100 < subs.size(); ++i) {
+            CHECK(subs[i]->hashes == reference);
+            CHECK(subs[i]->view == truth);
+        }
+        for (auto& s : late) CHECK(s->view == truth);
+
+        // Those that left saw a prefix of it.
+        for (std::size_t i = subs.size() - 100; i < subs.size(); ++i) {
+            const auto& h = subs[i]->hashes;
+            CHECK(h.size() <= reference.size());
+            CHECK(std::equal(h.begin(), h.end(), reference.begin()));
+        }
+    }
+    remove_db();
+    return check_result();
+}
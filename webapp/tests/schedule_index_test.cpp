@@ -0,0 +1,80 @@
+// tests/schedule_index_test.cpp
+// ScheduleIndex::active_at() against a linear scan over every window, for
+// every minute of randomly generated days (overlaps, windows that cross
+// midnight, carry-overs from the day before).
+#include "schedule_index.hpp"
+#include "check.hpp"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    constexpr int kMinutes = 24 * 60;
+
+    struct Spec {
+        int start;
+        int end;
+        bool carryover;
+    };
+
+    // The window that covers `minute` and started first (a carry-over started
+    // yesterday); the earliest added on a tie. -1 for none.
+    int reference(const std::vector<Spec>& specs, int minute) {
+        int best = -1;
+        int best_from = 0;
+        for (int i = 0; i < static_cast<int>(specs.size()); ++i) {
+            const Spec& s = specs[static_cast<std::size_t>(i)];
+            const bool wraps = s.end < s.start;
+            int from, to;
+            if (s.carryover) {
+                if (!wraps) continue;
+                from = 0;
+                to = s.end;
+            } else {
+                from = s.start;
+                to = wraps ? kMinutes - 1 : s.end;
+            }
+            if (minute < from || minute > to) continue;
+            if (best < 0 || from < best_from) {
+                best = i;
+                best_from = from;
+            }
+        }
+        return best;
+    }
+}
+
+int main() {
+    std::mt19937 rng(10);
+    for (int day = 0; day < 5000; ++day) {
+        std::vector<Spec> specs(rng() % 7);
+        ScheduleIndex index;
+        for (std::size_t i = 0; i < specs.size(); ++i) {
+            Spec& s = specs[i];
+            s.start = static_cast<int>(rng() % kMinutes);
+            // Mostly short procedures, some running past midnight.
+            s.end = rng() % 4 == 0 ? static_cast<int>(rng() % kMinutes)
+                                   : std::min(kMinutes - 1, s.start + static_cast<int>(rng() % 240));
+            s.carryover = rng() % 5 == 0;
+            ScheduleIndex::Window w{"w" + std::to_string(i), s.start, s.end};
+            if (s.carryover) index.add_carryover(std::move(w));
+            else index.add(std::move(w));
+        }
+        index.build();
+
+        for (int m = 0; m < kMinutes; ++m) {
+            const int want = reference(specs, m);
+            const ScheduleIndex::Window* got = index.active_at(m);
+            if (want < 0) {
+                CHECK(got == nullptr);
+            } else {
+                CHECK(got != nullptr && got->procedure == "w" + std::to_string(want));
+            }
+        }
+        CHECK(index.active_at(-1) == nullptr);
+        CHECK(index.active_at(kMinutes) == nullptr);
+        if (check_failures() > 20) break;
+    }
+    return check_result();
+}
@@ -0,0 +1,83 @@
+// tests/seq_tracker_test.cpp
+// SeqTracker: ordering, gaps, and telling a device restart from reordering,
+// including a restart whose seq-0 message was lost.
+#include "seq_tracker.hpp"
+#include "check.hpp"
+#include <optional>
+
+namespace {
+    using namespace std::chrono_literals;
+    using Verdict = SeqTracker::Verdict;
+    const SeqTracker::Clock::time_point t0{};
+    constexpr std::uint64_t kDays = 24ull * 3600 * 1000;
+
+    void in_order_and_gaps() {
+        SeqTracker t;
+        CHECK(t.check(1, 7, std::nullopt, t0).verdict == Verdict::Accept); // first one is taken as is
+        CHECK(t.check(1, 8, std::nullopt, t0 + 1s).gap == 0);
+        const auto r = t.check(1, 12, std::nullopt, t0 + 2s);
+        CHECK(r.verdict == Verdict::Accept && r.gap == 3);
+        // Rooms are independent.
+        CHECK(t.check(2, 3, std::nullopt, t0 + 2s).verdict == Verdict::Accept);
+        // Wraps around the u32.
+        CHECK(t.check(3, 0xFFFFFFFEu, std::nullopt, t0).verdict == Verdict::Accept);
+        const auto w = t.check(3, 1, std::nullopt, t0 + 1s);
+        CHECK(w.verdict == Verdict::Accept && w.gap == 2);
+    }
+
+    void reordering_is_stale() {
+        SeqTracker t;
+        t.check(1, 100, 5 * kDays, t0);
+        t.check(1, 102, 5 * kDays + 900, t0 + 1s);
+        // 101 was overtaken on another worker's client; 102 is a repeat.
+        CHECK(t.check(1, 101, 5 * kDays + 400, t0 + 1s + 5ms).verdict == Verdict::Stale);
+        CHECK(t.check(1, 102, 5 * kDays + 900, t0 + 1s + 6ms).verdict == Verdict::Stale);
+        CHECK(t.check(1, 103, 5 * kDays + 2000, t0 + 2s).verdict == Verdict::Accept);
+        // No ts: a short step back within the reorder span is still stale.
+        t.check(2, 50, std::nullopt, t0);
+        CHECK(t.check(2, 49, std::nullopt, t0 + 10s).verdict == Verdict::Stale);
+    }
+
+    void replay_of_last_message_is_stale() {
+        SeqTracker t;
+        t.check(1, 40, 600'000, t0);
+        // The broker replays the retained message an hour later.
+        CHECK(t.check(1, 40, 600'000, t0 + 1h).verdict == Verdict::Stale);
+    }
+
+    void restart_with_seq_zero() {
+        SeqTracker t;
+        t.check(1, 500, 10 * kDays, t0);
+        CHECK(t.check(1, 0, 20, t0 + 5s).verdict == Verdict::Reset);
+        CHECK(t.check(1, 1, 900, t0 + 6s).verdict == Verdict::Accept);
+        // A far step back is a restart even without a ts.
+        t.check(2, 5000, std::nullopt, t0);
+        CHECK(t.check(2, 3, std::nullopt, t0 + 1s).verdict == Verdict::Reset);
+    }
+
+    void restart_with_seq_zero_lost() {
+        // The device reboots 30 s after its last message; seq 0 never arrives.
+        SeqTracker t;
+        t.check(1, 500, 10 * kDays, t0);
+        CHECK(t.check(1, 1, 4'000, t0 + 30s).verdict == Verdict::Reset);
+        for (std::uint32_t seq = 2; seq < 50; ++seq) {
+            CHECK(t.check(1, seq, 4'000 + seq * 1000, t0 + 30s + std::chrono::seconds(seq)).verdict == Verdict::Accept);
+        }
+        // Also when the reboot lands exactly on the old seq.
+        t.check(2, 1, 3'000, t0);
+        CHECK(t.check(2, 1, 2'000, t0 + 10s).verdict == Verdict::Reset);
+        // Without a ts, a step back after a quiet spell is a restart.
+        t.check(3, 500, std::nullopt, t0);
+        CHECK(t.check(3, 1, std::nullopt, t0 + 2min).verdict == Verdict::Reset);
+        CHECK(t.check(3, 2, std::nullopt, t0 + 2min + 1s).verdict == Verdict::Accept);
+    }
+}
+
+int main() {
+    in_order_and_gaps();
+    reordering_is_stale();
+    replay_of_last_message_is_stale();
+    restart_with_seq_zero();
+    restart_with_seq_zero_lost();
+    return check_result();
+}
@@ -0,0 +1,127 @@
+// tests/state_payload_test.cpp
+// parse_state_payload() against nlohmann::json on generated and mutated
+// payloads: whenever the fast parser accepts one, nlohmann must parse it to
+// the same values the ingestor's fallback would read.
+#include "state_payload.hpp"
+#include "check.hpp"
+#include <nlohmann/json.hpp>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    std::mt19937 rng(12);
+
+    std::string pick(const std::vector<std::string>& options) {
+        return options[rng() % options.size()];
+    }
+
+    std::string ws() { return pick({"", "", "", " ", "\t", "\n ", "\r\n"}); }
+
+    std::string number() {
+        return pick({"0", "1", "42", "4294967295", "4294967296", "18446744073709551615",
+                     "18446744073709551616", "1735689600000", "01", "-1", "+1", "1.5", "1e3", "1E3", "", "x"});
+    }
+
+    std::string value() {
+        switch (rng() % 4) {
+            case 0:  return pick({"true", "false"});
+            case 1:  return number();
+            case 2:  return pick({"null", "\"true\"", "True", "truex", "fals", "[]", "{}"});
+            default: return pick({"true", "false"}) + pick({"", "", "x", "0"});
+        }
+    }
+
+    std::string member() {
+        const std::string key = pick({"suction_on", "suction_on", "motion", "seq", "ts", "other",
+                                      "suction\\u005fon", "Suction_on", ""});
+        std::string v;
+        if (key == "suction_on" || key == "motion") v = rng() % 4 ? pick({"true", "false"}) : value();
+        else if (key == "seq" || key == "ts") v = rng() % 4 ? number() : value();
+        else v = value();
+        return ws() + "\"" + key + "\"" + ws() + ":" + ws() + v + ws();
+    }
+
+    std::string payload() {
+        std::string out = ws() + "{";
+        const int n = static_cast<int>(rng() % 6);
+        for (int i = 0; i < n; ++i) {
+            if (i) out += pick({",", ",", ",", ",,", ";"});
+            out += member();
+        }
+        out += pick({"}", "}", "}", "", "}}", "},"}) + ws();
+        // Occasionally damage it at a random spot.
+        if (!out.empty() && rng() % 8 == 0) {
+            const std::size_t at = rng() % out.size();
+            if (rng() % 2) out.erase(at, 1);
+            else out.insert(at, 1, "{}\":,0 \"e"[rng() % 9]);
+        }
+        return out;
+    }
+
+    // Returns false (and reports) when the fast parser accepted something
+    // nlohmann reads differently.
+    bool agrees(const std::string& in) {
+        StatePayload fast;
+        if (!parse_state_payload(in, fast)) return true; // goes to the fallback
+        nlohmann::json j;
+        try {
+            j = nlohmann::json::parse(in);
+        } catch (const std::exception&) {
+            std::fprintf(stderr, "accepted invalid JSON: %s\n", in.c_str());
+            return false;
+        }
+        bool ok = j.is_object() && j.contains("suction_on") && j["suction_on"].is_boolean() &&
+                  j["suction_on"].get<bool>() == fast.suction_on;
+        if (auto it = j.find("motion"); it != j.end()) {
+            ok = ok && fast.has_motion && it->is_boolean() && it->get<bool>() == fast.motion;
+        } else {
+            ok = ok && !fast.has_motion;
+        }
+        if (auto it = j.find("seq"); it != j.end()) {
+            ok = ok && fast.has_seq && it->is_number_unsigned() && it->get<std::uint64_t>() == fast.seq;
+        } else {
+            ok = ok && !fast.has_seq;
+        }
+        if (auto it = j.find("ts"); it != j.end()) {
+            ok = ok && fast.has_ts && it->is_number_unsigned() && it->get<std::uint64_t>() == fast.ts;
+        } else {
+            ok = ok && !fast.has_ts;
+        }
+        ok = ok && j.size() == 1u + fast.has_motion + fast.has_seq + fast.has_ts;
+        if (!ok) std::fprintf(stderr, "reads differently: %s\n", in.c_str());
+        return ok;
+    }
+}
+
+int main() {
+    // What the firmware and suction-loadgen actually send must take the fast path.
+    StatePayload p;
+    CHECK(parse_state_payload(R"({"suction_on":true,"motion":false,"seq":7,"ts":123456})", p));
+    CHECK(p.suction_on && !p.motion && p.has_seq && p.seq == 7 && p.has_ts && p.ts == 123456);
+    CHECK(parse_state_payload(R"({"suction_on":false})", p));
+    CHECK(!p.suction_on && !p.has_motion && !p.has_seq && !p.has_ts);
+    CHECK(parse_state_payload(" { \"ts\" : 1735689600000 , \"suction_on\" : true } ", p));
+    CHECK(p.suction_on && p.ts == 1735689600000ULL);
+
+    CHECK(room_from_topic("suction/OR 1/state") == "OR 1");
+    CHECK(room_from_topic("suction/OR-2/state/bin") == "OR-2");
+    CHECK(room_from_topic("suction/x").empty());
+    // The longest name the ingestor takes, and one byte more.
+    const std::string longest(kMaxRoomName, 'r');
+    CHECK(kMaxRoomName == 62);
+    CHECK(room_from_topic("suction/" + longest + "/state") == longest);
+    CHECK(room_from_topic("suction/" + longest + "/state").size() <= kMaxRoomName);
+    CHECK(room_from_topic("suction/" + longest + "r/state/bin").size() > kMaxRoomName);
+
+    int accepted = 0;
+    for (int i = 0; i < 200000 && check_failures() < 20; ++i) {
+        const std::string in = payload();
+        StatePayload fast;
+        accepted += parse_state_payload(in, fast);
+        CHECK(agrees(in));
+    }
+    CHECK(accepted > 1000); // the generator still reaches the fast path
+    return check_result();
+}
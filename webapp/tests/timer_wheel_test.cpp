@@ -0,0 +1,73 @@
+// tests/timer_wheel_test.cpp
+// TimerWheel against a plain list of (key, due) entries over random
+// schedules, advances (including jumps of several laps) and re-arming
+// from inside on_expire.
+#include "timer_wheel.hpp"
+#include "check.hpp"
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+    using Entry = std::pair<int, std::uint64_t>; // key, due
+
+    struct Model {
+        std::uint64_t now = 0;
+        std::vector<Entry> entries;
+
+        void schedule(int key, std::uint64_t due) { entries.push_back({key, std::max(due, now + 1)}); }
+
+        // Keys due by `to`, sorted.
+        std::vector<int> advance(std::uint64_t to) {
+            std::vector<int> fired;
+            if (to <= now) return fired;
+            now = to;
+            auto due = std::stable_partition(entries.begin(), entries.end(),
+                                             [&](const Entry& e) { return e.second > to; });
+            for (auto it = due; it != entries.end(); ++it) fired.push_back(it->first);
+            entries.erase(due, entries.end());
+            std::sort(fired.begin(), fired.end());
+            return fired;
+        }
+    };
+
+    void run(std::size_t slots, std::uint32_t seed) {
+        std::mt19937 rng(seed);
+        TimerWheel wheel(slots);
+        Model model;
+        for (int step = 0; step < 10000 && check_failures() < 20; ++step) {
+            if (rng() % 3) {
+                const int key = static_cast<int>(rng() % 1000);
+                // Some already due, most within a lap or two, a few far out.
+                const std::uint64_t ahead = rng() % 10 == 0 ? rng() % 5000 : rng() % (3 * slots + 2);
+                const std::uint64_t due = wheel.now() + ahead - std::min<std::uint64_t>(wheel.now(), rng() % 3);
+                wheel.schedule(key, due);
+                model.schedule(key, due);
+                continue;
+            }
+            const std::uint64_t to = wheel.now() + (rng() % 20 == 0 ? rng() % 2000 : rng() % 8);
+            // Re-arm some of what fires, as DeviceLiveness does.
+            std::vector<std::pair<int, std::uint64_t>> rearmed;
+            std::vector<int> fired;
+            wheel.advance(to, [&](int key) {
+                fired.push_back(key);
+                if (key % 3 == 0) {
+                    const std::uint64_t due = to + 1 + static_cast<std::uint64_t>(key % 50);
+                    wheel.schedule(key, due);
+                    rearmed.push_back({key, due});
+                }
+            });
+            std::sort(fired.begin(), fired.end());
+            CHECK(fired == model.advance(to));
+            for (const auto& [key, due] : rearmed) model.schedule(key, due);
+            CHECK(wheel.now() == model.now);
+            CHECK(wheel.size() == model.entries.size());
+        }
+    }
+}
+
+int main() {
+    for (std::size_t slots : {1u, 2u, 7u, 64u, 512u}) run(slots, static_cast<std::uint32_t>(slots) * 15);
+    return check_result();
+}